@@ -0,0 +1,45 @@
+# Writes the SPIR-V module INPUT out as the C++ header OUTPUT, holding it as
+# shaders::NAME, an aligned constexpr array of its words. Run by
+# add_slang_shader through cmake -P, SOURCE only names the shader in the
+# header's comment.
+
+file (READ ${INPUT} SPIRV_HEX HEX)
+string (LENGTH "${SPIRV_HEX}" HEX_LENGTH)
+math (EXPR WORD_REMAINDER "${HEX_LENGTH} % 8")
+
+if (HEX_LENGTH LESS 8 OR NOT WORD_REMAINDER EQUAL 0)
+  message (FATAL_ERROR "${INPUT} is not a whole number of SPIR-V words")
+endif()
+
+# the magic number, as little endian bytes
+string (SUBSTRING "${SPIRV_HEX}" 0 8 MAGIC)
+if (NOT MAGIC STREQUAL "03022307")
+  message (FATAL_ERROR "${INPUT} is not a little endian SPIR-V module")
+endif()
+
+math (EXPR WORD_COUNT "${HEX_LENGTH} / 8")
+
+# bytes to little endian words, 8 words to a line
+string (REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${SPIRV_HEX}")
+# CMake regexes have no {n}, so the line is spelled out
+string (REPEAT "0x[0-9a-f]+, " 8 LINE)
+string (REGEX REPLACE "(${LINE})" "\\1\n    " WORDS "${WORDS}")
+string (REGEX REPLACE "\n *$" "" WORDS "${WORDS}")
+string (REGEX REPLACE " +(\n|$)" "\\1" WORDS "${WORDS}")
+
+get_filename_component (SOURCE_NAME ${SOURCE} NAME)
+
+file (WRITE ${OUTPUT}
+"// generated from ${SOURCE_NAME} by cmake/EmbedSpirv.cmake, do not edit
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace shaders {
+  alignas(16) inline constexpr std::array<std::uint32_t, ${WORD_COUNT}> ${NAME}{
+    ${WORDS}
+  };
+}
+")
+
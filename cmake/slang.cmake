@@ -1,18 +1,61 @@
-function (add_slang_shader_target TARGET)
-  cmake_parse_arguments ("SHADER" "" "" "SOURCES" ${ARGN})
-  set (SHADERS_DIR ${CMAKE_CURRENT_LIST_DIR}/shaders)
-  set (ENTRY_POINTS -entry vertMain -entry fragMain)
+set(SLANGC_EXECUTABLE slangc)
+find_program(SPIRV_OPT_EXECUTABLE spirv-opt)
+
+option(LEARN_VULKAN_OPTIMIZE_SHADERS "Compile shaders with slangc -O3" ON)
+option(LEARN_VULKAN_STRIP_SHADERS "Strip debug info from SPIR-V with spirv-opt" OFF)
+
+if (LEARN_VULKAN_STRIP_SHADERS AND NOT SPIRV_OPT_EXECUTABLE)
+  message(WARNING "spirv-opt not found, shaders are not stripped")
+endif()
+
+# every shader is compiled with these, hot reload passes the same ones
+set(SLANGC_FLAGS -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name)
+if (LEARN_VULKAN_OPTIMIZE_SHADERS)
+  list(APPEND SLANGC_FLAGS -O3)
+endif()
+
+# generated shader headers go here, included as <shaders/NAME.spv.hpp>
+set(SLANG_GENERATED_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+
+# Compiles SOURCE into its own SPIR-V module and embeds it as the constexpr
+# array shaders::NAME in <shaders/STEM.spv.hpp>, STEM being the source's file
+# name without extension. NAME defaults to STEM in upper case and
+# ENTRY_POINTS to every [shader(...)] entry point in the source. Imported
+# modules are tracked through slangc's depfile, and every shader is its own
+# custom command, so they build in parallel and only rebuild when they or
+# what they import change.
+function (add_slang_shader TARGET)
+  cmake_parse_arguments ("SHADER" "" "SOURCE;NAME" "ENTRY_POINTS" ${ARGN})
+  get_filename_component (SHADER_STEM ${SHADER_SOURCE} NAME_WE)
+  if (NOT SHADER_NAME)
+    string (TOUPPER ${SHADER_STEM} SHADER_NAME)
+  endif()
+
+  set (OUTPUT_DIR ${SLANG_GENERATED_DIR}/shaders)
+  set (SPIRV ${OUTPUT_DIR}/${SHADER_STEM}.spv)
+  set (HEADER ${OUTPUT_DIR}/${SHADER_STEM}.spv.hpp)
+
+  set (FLAGS ${SLANGC_FLAGS})
+  foreach (ENTRY_POINT ${SHADER_ENTRY_POINTS})
+    list (APPEND FLAGS -entry ${ENTRY_POINT})
+  endforeach()
+
+  set (STRIP_COMMAND)
+  if (LEARN_VULKAN_STRIP_SHADERS AND SPIRV_OPT_EXECUTABLE)
+    set (STRIP_COMMAND COMMAND ${SPIRV_OPT_EXECUTABLE} --strip-debug --strip-nonsemantic ${SPIRV} -o ${SPIRV})
+  endif()
+
   add_custom_command (
-          OUTPUT ${SHADERS_DIR}
-          COMMAND ${CMAKE_COMMAND} -E make_directory ${SHADERS_DIR}
-  )
-  add_custom_command (
-          OUTPUT  ${SHADERS_DIR}/slang.spv
-          COMMAND ${SLANGC_EXECUTABLE} ${SHADER_SOURCES} -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name ${ENTRY_POINTS} -o slang.spv
-          WORKING_DIRECTORY ${SHADERS_DIR}
-          DEPENDS ${SHADERS_DIR} ${SHADER_SOURCES}
-          COMMENT "Compiling Slang Shaders"
+          OUTPUT  ${SPIRV} ${HEADER}
+          COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
+          COMMAND ${SLANGC_EXECUTABLE} ${SHADER_SOURCE} ${FLAGS} -depfile ${SPIRV}.d -o ${SPIRV}
+          ${STRIP_COMMAND}
+          COMMAND ${CMAKE_COMMAND} -DINPUT=${SPIRV} -DOUTPUT=${HEADER} -DNAME=${SHADER_NAME} -DSOURCE=${SHADER_SOURCE} -P ${PROJECT_SOURCE_DIR}/cmake/EmbedSpirv.cmake
+          WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}/shaders
+          DEPENDS ${SHADER_SOURCE} ${PROJECT_SOURCE_DIR}/cmake/EmbedSpirv.cmake
+          DEPFILE ${SPIRV}.d
+          COMMENT "Compiling Slang shader ${SHADER_STEM}"
           VERBATIM
   )
-  add_custom_target (${TARGET} DEPENDS ${SHADERS_DIR}/slang.spv)
+  add_custom_target (${TARGET} DEPENDS ${HEADER})
 endfunction()
@@ -1,51 +1,197 @@
 #include "App.hpp"
+#include "MappedFile.hpp"
+#include <shaders/cull.spv.hpp>
+#include <shaders/particles.spv.hpp>
+#include <shaders/triangle.spv.hpp>
 #include <GLFW/glfw3.h>
 #include <fmt/core.h>
 #include <fmt/printf.h>
 #include <fmt/ranges.h>
+#include <cmath>
 #include <queue>
+#include <ranges>
 #include <spdlog/common.h>
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
 #include <spdlog/spdlog.h>
-#include <fstream>
 
-auto App::init_vulkan() -> void {
+App::App(AppConfig config):
+    config{std::move(config)},
+    latency{latency_profile::get_settings(this->config.latency_profile)} {
+  if (this->config.frames_in_flight == 0) {
+    this->config.frames_in_flight = latency.frames_in_flight;
+  }
 
-  create_instance();
-  setup_debug_messenger();
-  pick_physical_device();
-  create_logical_device();
-  create_swap_chain();
-  create_image_view();
-  create_graphics_pipeline();
-  create_command_pool();
-  create_command_buffer();
-}
+  this->config.frames_in_flight =
+    std::clamp(this->config.frames_in_flight, 1u, MAX_FRAMES_IN_FLIGHT);
+
+  pacer.set_enabled(latency.pace_frames);
+
+  this->config.render_scale = std::clamp(
+    this->config.render_scale,
+    MIN_RENDER_SCALE,
+    MAX_RENDER_SCALE
+  );
+
+  if (this->config.headless and this->config.frame_limit == 0) {
+    this->config.frame_limit = DEFAULT_HEADLESS_FRAME_LIMIT;
+  }
 
-auto read_file_contents(const StringView path) -> Vec<u8> {
-  std::ifstream file{path.data(), std::ios::binary | std::ios::ate};
+  profiler.set_tracing(not this->config.trace_path.empty());
+  profiler.set_history_size(this->config.profiler_history);
 
-  if (!file.is_open()) {
-    throw std::runtime_error("failed to open file!");
+  const u32 output_count{
+    this->config.headless ? 1 : std::max(this->config.window_count, 1u)
+  };
+
+  outputs.resize(output_count);
+
+  for (u32 i = 0; i < output_count; i++) {
+    outputs[i].app = this;
+    outputs[i].name = fmt::format("output_{}", i);
   }
+}
 
-  std::vector<u8> buffer{};
-  buffer.reserve(static_cast<usize>(file.tellg()));
+auto App::init_vulkan() -> void {
+  const Profiler::CpuScope init_scope{profiler, "init_vulkan"};
 
-  for (i32 i = 0; i < file.tellg(); i++) {
-    buffer.push_back(0);
+  // everything else runs on it
+  {
+    const Profiler::CpuScope scope{profiler, "create_job_system"};
+    create_job_system();
   }
 
-  file.seekg(0, std::ios::beg);
-  file.read(
-    reinterpret_cast<char*>(buffer.data()),
-    static_cast<ptrdiff>(buffer.size())
+  TaskGraph graph{};
+  using enum TaskGraph::Affinity;
+
+  using StageFn = void (App::*)();
+
+  const auto stage = [&](
+                       const StringView name,
+                       const StageFn create,
+                       const std::initializer_list<TaskGraph::TaskId> after,
+                       const TaskGraph::Affinity affinity = eAnyThread
+                     ) -> TaskGraph::TaskId {
+    return graph.add(
+      name,
+      [this, name, create] {
+        const Profiler::CpuScope scope{profiler, name};
+        (this->*create)();
+      },
+      after,
+      affinity
+    );
+  };
+
+  // GLFW may only be driven from the main thread
+  const auto glfw = stage("init_glfw", &App::init_glfw, {}, eMainThread);
+  const auto window =
+    stage("create_windows", &App::create_windows, {glfw}, eMainThread);
+
+  const auto instance = stage("create_instance", &App::create_instance, {glfw});
+  stage("setup_debug_messenger", &App::setup_debug_messenger, {instance});
+  const auto physical =
+    stage("pick_physical_device", &App::pick_physical_device, {instance});
+  const auto surface =
+    stage("create_surfaces", &App::create_surfaces, {instance, window});
+  const auto device =
+    stage("create_logical_device", &App::create_logical_device, {physical});
+  stage("create_profiler", &App::create_profiler, {device});
+  const auto allocator =
+    stage("create_allocator", &App::create_allocator, {device});
+  const auto staging =
+    stage("create_staging_ring", &App::create_staging_ring, {allocator});
+  const auto cache =
+    stage("create_pipeline_cache", &App::create_pipeline_cache, {device});
+  const auto uniforms =
+    stage("create_uniform_ring", &App::create_uniform_ring, {allocator});
+
+  // the ring's set is part of the pipeline layout the heap owns
+  const auto heap =
+    stage("create_bindless_heap", &App::create_bindless_heap, {uniforms});
+
+  // the pipeline only needs the format, so it compiles while the swapchain
+  // is being created
+  const auto format = stage(
+    "choose_swap_chain_format",
+    &App::choose_swap_chain_format,
+    {physical, surface}
   );
+  // the extent may come from glfwGetFramebufferSize, so main thread too
+  const auto swap_chain = stage(
+    "create_swap_chains",
+    &App::create_swap_chains,
+    {device, allocator, surface, format},
+    eMainThread
+  );
+  stage("create_image_views", &App::create_image_views, {swap_chain});
+  stage(
+    "create_graphics_pipeline",
+    &App::create_graphics_pipeline,
+    {cache, heap, format}
+  );
+
+  const auto pool =
+    stage("create_command_pool", &App::create_command_pool, {device});
+  const auto buffers = stage(
+    "create_command_buffer",
+    &App::create_command_buffer,
+    {pool, allocator}
+  );
+  stage(
+    "create_sync_objects",
+    &App::create_sync_objects,
+    {buffers, swap_chain}
+  );
+
+  // the staging ring is not thread safe, so uploads are chained
+  const auto vertices =
+    stage("create_vertex_buffers", &App::create_vertex_buffers, {staging});
+  const auto instances =
+    stage("create_instance_buffer", &App::create_instance_buffer, {vertices});
+
+  if (not config.capture_path.empty()) {
+    // the swapchain decides whether its images can be copied from
+    stage(
+      "create_frame_capture",
+      &App::create_frame_capture,
+      {allocator, swap_chain}
+    );
+  }
+
+  // the bindless heap registers from one thread at a time, so the passes
+  // that add buffers to it are chained
+  TaskGraph::TaskId registered{heap};
+
+  if (config.gpu_driven) {
+    registered = stage(
+      "create_cull_pass",
+      &App::create_cull_pass,
+      {instances, cache, heap}
+    );
+  }
+
+  if (config.particle_count > 0) {
+    stage(
+      "create_particle_system",
+      &App::create_particle_system,
+      {registered, allocator, cache}
+    );
+  }
+
+  graph.run(*jobs);
+  graph.log_critical_path();
 
-  return buffer;
+  for (const TaskGraph::Timing& timing: graph.get_timings()) {
+    const std::chrono::duration<f64, std::milli> elapsed{
+      timing.end - timing.start
+    };
+    init_stages.push_back({.name = timing.name, .ms = elapsed.count()});
+  }
+
+  pipeline_cache.log_stats();
 }
 
 auto App::run() -> void {
@@ -61,7 +207,7 @@ auto App::create_instance() -> void {
   Vec<const char*> extensions{get_required_extensions()};
 
   spdlog::info(
-    "GLFW Required Extensions ({} total): \n{}",
+    "Required Instance Extensions ({} total): \n{}",
     extensions.size(),
     extensions
   );
@@ -91,7 +237,7 @@ auto App::create_instance() -> void {
 
     if (not supported) {
       throw std::runtime_error(
-        fmt::format("GLFW Extension {} is not supported", extension)
+        fmt::format("Instance Extension {} is not supported", extension)
       );
     }
   }
@@ -129,8 +275,8 @@ auto App::create_instance() -> void {
   vk::InstanceCreateInfo info{};
 
   info.pApplicationInfo = &APP_INFO,
-  info.enabledLayerCount = VALIDATION_LAYERS.size(),
-  info.ppEnabledLayerNames = VALIDATION_LAYERS.data(),
+  info.enabledLayerCount = required_validation_layers.size(),
+  info.ppEnabledLayerNames = required_validation_layers.data(),
   info.enabledExtensionCount = extensions.size(),
   info.ppEnabledExtensionNames = extensions.data(),
 
@@ -139,336 +285,1726 @@ auto App::create_instance() -> void {
 #endif
   spdlog::info("Creating VK Instance");
   instance = context.createInstance(info);
+}
+
+auto App::init_glfw() -> void {
+  if (config.headless) {
+    spdlog::info("Running headless, skipping GLFW");
+    return;
+  }
 
   glfwInit();
+}
+
+auto App::create_windows() -> void {
+  if (config.headless) {
+    return;
+  }
+
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-  spdlog::info("Creating GLFW window");
-  window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
-}
+  spdlog::info("Creating {} GLFW window(s)", outputs.size());
 
-auto App::update() -> void {
-  spdlog::info("Update loop started");
+  for (usize i = 0; i < outputs.size(); i++) {
+    Output& output{outputs[i]};
 
-  while (not glfwWindowShouldClose(window)) {
-    glfwPollEvents();
+    const String title{i == 0 ? String{"Vulkan"} : fmt::format("Vulkan {}", i)};
+    output.window =
+      glfwCreateWindow(WIDTH, HEIGHT, title.c_str(), nullptr, nullptr);
+
+    // some platforms never report out of date on resize, so flag it
+    // ourselves
+    glfwSetWindowUserPointer(output.window, &output);
+    glfwSetFramebufferSizeCallback(
+      output.window,
+      [](GLFWwindow* resized, i32, i32) {
+        static_cast<Output*>(glfwGetWindowUserPointer(resized))->dirty = true;
+      }
+    );
+
+    glfwSetKeyCallback(
+      output.window,
+      [](GLFWwindow* pressed, const i32 key, i32, const i32 action, i32) {
+        if (key != GLFW_KEY_C or action != GLFW_PRESS) {
+          return;
+        }
+
+        // the next frame draws with the generic pipeline until the variant
+        // has compiled
+        AppConfig& config{
+          static_cast<Output*>(glfwGetWindowUserPointer(pressed))->app->config
+        };
+        config.color_mode =
+          (config.color_mode + 1) % PipelineVariants::COLOR_MODE_COUNT;
+      }
+    );
   }
 }
 
-auto App::cleanup() -> void {
+auto App::create_surfaces() -> void {
+  if (config.headless) {
+    return;
+  }
 
-  pipeline_layout.clear();
-  graphics_pipeline.clear();
-  swap_chain_image_views.clear();
-  swap_chain.clear();
-  graphics_queue.clear();
-  device.clear();
-  surface.clear();
-  physical_device.clear();
+  for (Output& output: outputs) {
+    VkSurfaceKHR vk_surface{};
+
+    if (glfwCreateWindowSurface(
+          *instance,
+          output.window,
+          nullptr,
+          &vk_surface
+        )) {
+      const char* error{};
+      glfwGetError(&error);
+      spdlog::warn("GLFW: {}", error);
+      throw std::runtime_error("Failed to create window surface");
+    }
 
-  spdlog::info("Killing window");
-  glfwDestroyWindow(window);
-  //
-  spdlog::info("Terminating GLFW");
-  glfwTerminate();
+    output.surface = {instance, vk_surface};
+  }
 }
 
-auto App::get_required_extensions() -> Vec<const char*> {
-  u32 extension_count = 0;
-  Span<const char*> glfw_extensions{
-    glfwGetRequiredInstanceExtensions(&extension_count),
-    extension_count,
+auto App::update() -> void {
+  spdlog::info(
+    "Update loop started ({} profile, {} frames in flight, {}, {} images, "
+    "{} output(s))",
+    latency_profile::get_name(config.latency_profile),
+    config.frames_in_flight,
+    config.headless ? "offscreen"
+                    : vk::to_string(outputs.front().present_mode),
+    outputs.front().images.size(),
+    outputs.size()
+  );
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // events are polled by draw_frame, right before recording
+  while (not should_close()) {
+    {
+      const Profiler::CpuScope scope{profiler, "frame"};
+      draw_frame();
+    }
+
+    pipeline_cache.save_if_due();
+  }
+
+  // nothing may be in flight once we start tearing resources down
+  device.waitIdle();
+  profiler.collect_all();
+
+  const std::chrono::duration<f64> elapsed{
+    std::chrono::steady_clock::now() - start
   };
 
-  Vec<const char*> extensions{glfw_extensions.begin(), glfw_extensions.end()};
+  spdlog::info(
+    "Rendered {} frames in {:.3f}s ({:.1f} fps)",
+    frame_number,
+    elapsed.count(),
+    static_cast<f64>(frame_number) / elapsed.count()
+  );
+}
 
-  if (ENABLE_VALIDATION_LAYERS) {
-    extensions.push_back(vk::EXTDebugUtilsExtensionName);
+auto App::should_close() const -> bool {
+  if (config.frame_limit != 0 and frame_number >= config.frame_limit) {
+    return true;
   }
 
-#if _OSX
-  extensions.push_back(vk::KHRPortabilityEnumerationExtensionName);
-  extensions.push_back("VK_EXT_metal_surface");
-  extensions.push_back(vk::KHRSurfaceExtensionName);
-#endif
+  if (config.headless) {
+    return false;
+  }
 
-  return extensions;
+  // the outputs share one frame loop, closing any of them ends it
+  return ranges::any_of(outputs, [](const Output& output) {
+    return glfwWindowShouldClose(output.window) != 0;
+  });
 }
 
-auto App::setup_debug_messenger() -> void {
-  if (not ENABLE_VALIDATION_LAYERS) {
+auto App::draw_frame() -> void {
+  bool all_minimized{not config.headless};
+
+  for (Output& output: outputs) {
+    // a minimized output stays dirty and sits frames out until it is back
+    if (not output.dirty or recreate_swap_chain(output)) {
+      all_minimized = false;
+    }
+  }
+
+  if (all_minimized) {
+    // nothing to draw into until a window comes back
+    glfwWaitEvents();
     return;
   }
-  spdlog::info("Setting up debug messenger");
 
-  constexpr vk::DebugUtilsMessageSeverityFlagsEXT SEVERITY_FLAGS{
-    vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose
-    | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning
-    | vk::DebugUtilsMessageSeverityFlagBitsEXT::eError
-  };
+  const u64 value = frame_number + 1;
+  const auto frame_index = static_cast<u32>(frame_number % frames.size());
+  FrameData& frame{frames.at(frame_index)};
 
-  constexpr vk::DebugUtilsMessageTypeFlagsEXT MESSAGE_TYPE_FLAGS =
-    vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral
-    | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance
-    | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation;
+  // the CPU may run at most frames_in_flight submissions ahead, so wait for
+  // the previous submission that used this slot to retire
+  {
+    const Profiler::CpuScope scope{profiler, "wait_for_frame"};
+    wait_for_timeline(frame.timeline_value);
+  }
 
-  const vk::DebugUtilsMessengerCreateInfoEXT debug_utils_create_info{
-    .messageSeverity = SEVERITY_FLAGS,
-    .messageType = MESSAGE_TYPE_FLAGS,
-    .pfnUserCallback = &debug_callback
-  };
+  frame.arena.reset();
 
-  auto debug_messager =
-    instance.createDebugUtilsMessengerEXT(debug_utils_create_info);
-}
+  const u64 completed_value{frame_timeline.getCounterValue()};
+  deletion_queue.collect(completed_value);
+  bindless.collect(completed_value);
+  capture.collect(completed_value);
+  staging_ring.retire(completed_value);
+  uniform_ring.retire(completed_value);
+  allocator.begin_frame(frame_index);
 
-vk::Bool32 App::debug_callback(
-  vk::DebugUtilsMessageSeverityFlagBitsEXT severity,
-  vk::DebugUtilsMessageTypeFlagsEXT type,
-  const vk::DebugUtilsMessengerCallbackDataEXT* callback_data,
-  void* //
-) {
+  apply_pending_pipeline();
 
-  spdlog::level::level_enum level{};
-  switch (severity) {
-    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo:
-      level = spdlog::level::level_enum::info;
-      break;
+  bool any_acquired{false};
 
-    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning:
-      level = spdlog::level::level_enum::warn;
-      break;
+  {
+    const Profiler::CpuScope scope{profiler, "acquire_image"};
+    pacer.mark_acquiring();
 
-    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eError:
-      level = spdlog::level::level_enum::err;
-      break;
+    for (Output& output: outputs) {
+      output.image_index = acquire_image(output, frame_index);
+      any_acquired = any_acquired or output.image_index.is_some();
+    }
+  }
 
-    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose:
-    default: level = spdlog::level::level_enum::trace; break;
+  if (not any_acquired) {
+    // nothing was acquired so no image_available was signalled, the slot is
+    // reused as is for the next attempt
+    glfwPollEvents();
+    return;
   }
 
-  spdlog::log(
-    level,
-    "Layer: {} msg: {}",
-    vk::to_string(type),
-    callback_data->pMessage
-  );
+  {
+    const Profiler::CpuScope scope{profiler, "pacing"};
+    pacer.wait_for_sample();
+  }
 
-  return vk::False;
-}
+  // input is sampled as late as possible, everything from here to the submit
+  // is latency the user feels
+  {
+    const Profiler::CpuScope scope{profiler, "sample_to_submit"};
+    if (not config.headless) {
+      glfwPollEvents();
+    }
 
-auto App::pick_physical_device() -> void {
-  assert(instance != nullptr);
-  spdlog::info("Picking physical device");
+    submit_frame(frame, value);
+  }
 
-  Vec<vk::raii::PhysicalDevice> devices = instance.enumeratePhysicalDevices();
+  frame.timeline_value = value;
+  frame_number = value;
 
-  if (devices.empty()) {
-    throw std::runtime_error{"Could not find a GPU with Vulkan support"};
+  if (config.headless) {
+    return;
   }
 
-  for (vk::raii::PhysicalDevice& device: devices) {
-    if (not is_device_suitable(device)) {
-      continue;
-    }
+  const Profiler::CpuScope scope{profiler, "present"};
+  present_outputs(frame);
+}
 
-    physical_device = std::move(device);
-    break;
+auto App::acquire_image(Output& output, const u32 frame_index)
+  -> Option<u32> {
+  if (config.headless) {
+    // there are always at least as many offscreen images as frames in
+    // flight, so the slot wait also covers reuse of this image
+    return static_cast<u32>(frame_number % output.images.size());
   }
 
-  if (physical_device == nullptr) {
-    throw std::runtime_error{
-      "Could not find any suitable GPU's (Graphics Support)"
-    };
+  // still dirty after draw_frame tried to recreate it, so minimized
+  if (output.dirty) {
+    return crab::none;
+  }
+
+  try {
+    auto [result, index] = output.swap_chain.acquireNextImage(
+      std::numeric_limits<u64>::max(),
+      output.image_available.at(frame_index),
+      nullptr
+    );
+
+    // still presentable, recreate once this frame is out
+    if (result == vk::Result::eSuboptimalKHR) {
+      output.dirty = true;
+    }
+
+    return index;
+  } catch (const vk::OutOfDateKHRError&) {
+    output.dirty = true;
+    return crab::none;
   }
 }
 
-auto App::is_device_suitable(const vk::raii::PhysicalDevice& device) -> bool {
-  const vk::PhysicalDeviceProperties properties{device.getProperties()};
+auto App::submit_frame(FrameData& frame, const u64 value) -> void {
+  const bool waits_on_transfer{submit_async_uploads(frame, value)};
 
-  if (properties.apiVersion < VK_API_VERSION_1_3) {
-    spdlog::trace("Unsupporetd API version");
-    return false;
+  // submitted ahead of the graphics work, so it overlaps whatever is left of
+  // the previous frame's
+  const bool waits_on_compute{submit_async_compute(frame, value)};
+  const auto frame_index = static_cast<u32>(frame_number % frames.size());
+
+  // resolved once here, recording threads only read it
+  variant_key = {.color_mode = config.color_mode};
+
+  if (not shader_object) {
+    current_pipeline = pipelines.get(variant_key);
   }
 
-  const bool has_queue_family = find_graphics_queue_family(device).is_some();
+  draw_constants_offset =
+    uniform_ring.push(PipelineVariants::get_draw_constants(variant_key));
 
-  if (not has_queue_family) {
-    spdlog::trace("No queue family found");
-    return false;
+  {
+    const Profiler::CpuScope scope{profiler, "record"};
+    frame.command_buffer.reset();
+    recorder.begin_frame(frame_index);
+    record_command_buffer(frame.command_buffer);
   }
 
-  const Vec<vk::ExtensionProperties> extensions{
-    device.enumerateDeviceExtensionProperties()
+  const vk::CommandBufferSubmitInfo command_buffer_info{
+    .commandBuffer = frame.command_buffer,
   };
 
-  for (const StringView extension: DEVICE_EXTENSIONS) {
-    const bool is_supported = ranges::any_of(
-      extensions,
-      [extension](const vk::ExtensionProperties& requested) {
-        return requested.extensionName == extension;
-      }
-    );
+  std::pmr::vector<vk::SemaphoreSubmitInfo> wait_infos{&frame.arena};
+  std::pmr::vector<vk::SemaphoreSubmitInfo> signal_infos{&frame.arena};
 
-    if (not is_supported) {
-      return false;
+  signal_infos.push_back({
+    .semaphore = frame_timeline,
+    .value = value,
+    .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+  });
+
+  // every output drawn this frame goes through this one submission, headless
+  // ones have no swapchain semaphores to wait on or signal
+  for (const Output& output: outputs) {
+    if (config.headless or output.image_index.is_none()) {
+      continue;
     }
+
+    wait_infos.push_back({
+      .semaphore = output.image_available.at(frame_index),
+      .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+    });
+    // the image's last use may be a capture copy, and its move to present
+    // layout has to be in the signal's scope, so everything is covered
+    signal_infos.push_back({
+      .semaphore =
+        output.render_finished.at(output.image_index.get_unchecked()),
+      .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+    });
   }
 
-  return true;
-}
+  if (waits_on_transfer) {
+    wait_infos.push_back({
+      .semaphore = transfer_timeline,
+      .value = value,
+      .stageMask = StagingRing::CONSUMER_STAGES,
+    });
+  }
 
-auto App::find_graphics_queue_family(const vk::raii::PhysicalDevice& device)
-  -> Option<u32> {
+  // only the particle draws read what compute wrote
+  if (waits_on_compute) {
+    wait_infos.push_back({
+      .semaphore = compute_timeline,
+      .value = value,
+      .stageMask = vk::PipelineStageFlagBits2::eVertexAttributeInput,
+    });
+  }
 
-  const Vec<vk::QueueFamilyProperties> queue_families{
-    device.getQueueFamilyProperties()
+  const vk::SubmitInfo2 submit_info{
+    .waitSemaphoreInfoCount = static_cast<u32>(wait_infos.size()),
+    .pWaitSemaphoreInfos = wait_infos.data(),
+    .commandBufferInfoCount = 1,
+    .pCommandBufferInfos = &command_buffer_info,
+    .signalSemaphoreInfoCount = static_cast<u32>(signal_infos.size()),
+    .pSignalSemaphoreInfos = signal_infos.data(),
   };
 
-  for (u32 i = 0; i < queue_families.size(); i++) {
-    const vk::QueueFamilyProperties& property{queue_families.at(i)};
+  graphics_queue.submit2(submit_info);
+  uniform_ring.submit(value);
+}
+
+auto App::present_outputs(FrameData& frame) -> void {
+  std::pmr::vector<vk::Semaphore> wait_semaphores{&frame.arena};
+  std::pmr::vector<vk::SwapchainKHR> swap_chains{&frame.arena};
+  std::pmr::vector<u32> image_indices{&frame.arena};
+  std::pmr::vector<Output*> presented{&frame.arena};
 
-    if ((property.queueFlags & vk::QueueFlagBits::eGraphics)
-        != static_cast<vk::QueueFlagBits>(0)) {
-      return i;
+  for (Output& output: outputs) {
+    if (output.image_index.is_none()) {
+      continue;
     }
-  }
 
-  return crab::none;
-}
+    const u32 image_index{output.image_index.get_unchecked()};
+    wait_semaphores.push_back(output.render_finished.at(image_index));
+    swap_chains.push_back(output.swap_chain);
+    image_indices.push_back(image_index);
+    presented.push_back(&output);
+  }
 
-auto App::create_logical_device() -> void {
-  spdlog::info("Creating logical device");
+  // one result per swapchain, so one out of date window does not get every
+  // other one recreated with it
+  std::pmr::vector<vk::Result> results(
+    presented.size(),
+    vk::Result::eSuccess,
+    &frame.arena
+  );
 
-  const Option<u32> graphics_queue_index{
-    find_graphics_queue_family(physical_device)
+  const vk::PresentInfoKHR present_info{
+    .waitSemaphoreCount = static_cast<u32>(wait_semaphores.size()),
+    .pWaitSemaphores = wait_semaphores.data(),
+    .swapchainCount = static_cast<u32>(swap_chains.size()),
+    .pSwapchains = swap_chains.data(),
+    .pImageIndices = image_indices.data(),
+    .pResults = results.data(),
   };
 
-  if (graphics_queue_index.is_none()) {
-    throw std::runtime_error{
-      std::format("Could not find graphics queue family for device")
+  try {
+    [[maybe_unused]] const vk::Result result{
+      graphics_queue.presentKHR(present_info)
     };
+  } catch (const vk::OutOfDateKHRError&) {
+    // the per swapchain results are still written, and say which
   }
 
-  const f32 priorities{0.f};
-  vk::DeviceQueueCreateInfo queue_create_info{
-    .queueFamilyIndex = graphics_queue_index.get_unchecked(),
-    .queueCount = 1,
-    .pQueuePriorities = &priorities
-  };
+  for (usize i = 0; i < presented.size(); i++) {
+    if (results[i] != vk::Result::eSuccess) {
+      presented[i]->dirty = true;
+    }
+  }
+}
 
-  const vk::StructureChain<
-    vk::PhysicalDeviceFeatures2,
-    vk::PhysicalDeviceVulkan13Features,
-    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>
-    feature_name{
-      {},
-      {.dynamicRendering = true},
-      {.extendedDynamicState = true}
-    };
+auto App::record_command_buffer(vk::raii::CommandBuffer& cmd) -> void {
+  cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
-  vk::DeviceCreateInfo device_create_info{
-    .pNext = &feature_name.get<vk::PhysicalDeviceFeatures2>(),
-    .queueCreateInfoCount = 1,
-    .pQueueCreateInfos = &queue_create_info,
-    .enabledExtensionCount = static_cast<u32>(DEVICE_EXTENSIONS.size()),
-    .ppEnabledExtensionNames = DEVICE_EXTENSIONS.data()
+  profiler.begin_gpu_frame(cmd, static_cast<u32>(frame_number % frames.size()));
 
-  };
+  // scopes have to close before the command buffer does
+  {
+    const Profiler::GpuScope scope{profiler, cmd, "frame"};
+    record_frame(cmd);
+  }
 
-  device = vk::raii::Device{
-    physical_device,
-    device_create_info,
-  };
+  cmd.end();
+}
 
-  graphics_queue = vk::raii::Queue{
-    device,
-    graphics_queue_index.get_unchecked(),
-    0,
-  };
+auto App::record_frame(const vk::raii::CommandBuffer& cmd) -> void {
+  render_graph.begin(static_cast<u32>(frame_number % frames.size()));
+
+  // uploads synchronise themselves against everything that reads them
+  render_graph.add_pass(
+    "uploads",
+    {},
+    [this](const vk::raii::CommandBuffer& cmd) {
+      const Profiler::GpuScope scope{profiler, cmd, "uploads"};
 
-  // create surface
-  VkSurfaceKHR vk_surface{};
+      // uploads that went through the transfer queue become ours here
+      queue_ownership::record(cmd, pending_acquires);
+      pending_acquires.clear();
+
+      // every upload queued since the last frame goes out as one batch
+      staging_ring.flush(cmd, frame_number + 1);
+    },
+    true
+  );
+
+  // the draws every output's pass reads besides its own image
+  Vec<RenderGraph::Use> shared_uses{};
+
+  if (config.gpu_driven) {
+    // last read by the previous frame's indirect draws
+    const RenderGraph::ResourceId draws{render_graph.import_buffer(
+      "draws",
+      cull_pass.get_draw_buffer(),
+      RenderGraph::INDIRECT_READ
+    )};
+    const RenderGraph::ResourceId draw_count{render_graph.import_buffer(
+      "draw_count",
+      cull_pass.get_count_buffer(),
+      RenderGraph::INDIRECT_READ
+    )};
+
+    render_graph.add_pass(
+      "cull",
+      {
+        {.resource = draws, .access = CullPass::CULL_ACCESS},
+        {.resource = draw_count, .access = CullPass::CULL_ACCESS},
+      },
+      [this](const vk::raii::CommandBuffer& cmd) {
+        const Profiler::GpuScope scope{profiler, cmd, "cull"};
+        cull_pass.record_cull(cmd);
+      }
+    );
 
-  if (glfwCreateWindowSurface(*instance, window, nullptr, &vk_surface)) {
-    const char* error{};
-    glfwGetError(&error);
-    spdlog::warn("GLFW: {}", error);
-    throw std::runtime_error("Failed to create window surface");
+    shared_uses.push_back(
+      {.resource = draws, .access = RenderGraph::INDIRECT_READ}
+    );
+    shared_uses.push_back(
+      {.resource = draw_count, .access = RenderGraph::INDIRECT_READ}
+    );
   }
 
-  surface = {instance, vk_surface};
-}
+  // culling and uploads happen once, then every output draws the same scene
+  // into its own image
+  Option<RenderGraph::ResourceId> first_target{};
 
-auto App::create_swap_chain() -> void {
-  const vk::SurfaceCapabilitiesKHR surface_capabilities{
-    physical_device.getSurfaceCapabilitiesKHR(surface)
+  const auto scale = [this](const u32 size) -> u32 {
+    const f32 scaled{static_cast<f32>(size) * config.render_scale};
+    return std::max(static_cast<u32>(scaled), 1u);
   };
 
-  const Vec<vk::SurfaceFormatKHR> available_formats{
-    physical_device.getSurfaceFormatsKHR(surface)
-  };
+  for (const Output& output: outputs) {
+    if (output.image_index.is_none()) {
+      continue;
+    }
 
-  const Vec<vk::PresentModeKHR> presentation_modes{
-    physical_device.getSurfacePresentModesKHR(surface)
-  };
+    const u32 image_index{output.image_index.get_unchecked()};
+
+    // acquired images are waited on at colour output and cleared, so their
+    // contents never matter
+    const RenderGraph::ResourceId target{render_graph.import_image(
+      output.name,
+      output.images.at(image_index),
+      *output.image_views.at(image_index),
+      {.stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput},
+      // offscreen images are left ready to be copied out
+      config.headless ? vk::ImageLayout::eTransferSrcOptimal
+                      : vk::ImageLayout::ePresentSrcKHR
+    )};
+
+    if (&output == &outputs.front()) {
+      first_target = target;
+    }
 
-  swap_chain_surface_format = choose_swap_surface_format(available_formats);
+    // a scaled scene goes through an image of its own, which only lives
+    // until it is blitted over the output, so every output's can share the
+    // same memory
+    const bool scaled{config.render_scale != 1.0f};
+    const vk::Extent2D scene_extent{
+      scaled ? vk::Extent2D{
+                 .width = scale(output.extent.width),
+                 .height = scale(output.extent.height),
+               }
+             : output.extent
+    };
+    const RenderGraph::ResourceId scene{
+      scaled ? render_graph.create_image(
+                 "scene",
+                 {
+                   .format = swap_chain_image_format,
+                   .extent = scene_extent,
+                   .usage = vk::ImageUsageFlagBits::eColorAttachment
+                          | vk::ImageUsageFlagBits::eTransferSrc,
+                 }
+               )
+             : target
+    };
 
-  swap_chain_surface_present_mode =
-    choose_swap_surface_present_mode(presentation_modes);
-  swap_chain_extent = choose_swap_extent(surface_capabilities);
+    Vec<RenderGraph::Use> draw_uses{shared_uses};
+    draw_uses.push_back(
+      {.resource = scene, .access = RenderGraph::COLOR_ATTACHMENT_WRITE}
+    );
 
-  u32 min_image_count = std::max(3u, surface_capabilities.minImageCount);
-  min_image_count = {
-    (surface_capabilities.maxImageCount > 0
-     and min_image_count > surface_capabilities.maxImageCount)
-      ? surface_capabilities.maxImageCount
-      : min_image_count
-  };
+    render_graph.add_pass(
+      "draw",
+      std::move(draw_uses),
+      [this, scene, scene_extent](const vk::raii::CommandBuffer& cmd) {
+        const Profiler::GpuScope scope{profiler, cmd, "draw"};
+        record_draw_pass(cmd, render_graph.get_image_view(scene), scene_extent);
+      }
+    );
 
-  u32 image_count = surface_capabilities.minImageCount + 1;
+    if (not scaled) {
+      continue;
+    }
 
-  if (surface_capabilities.maxImageCount > 0
-      && image_count > surface_capabilities.maxImageCount) {
-    image_count = surface_capabilities.maxImageCount;
+    render_graph.add_pass(
+      "upscale",
+      {
+        {.resource = scene, .access = RenderGraph::BLIT_READ},
+        {.resource = target, .access = RenderGraph::BLIT_WRITE},
+      },
+      [this, scene, scene_extent, target, extent = output.extent](
+        const vk::raii::CommandBuffer& cmd
+      ) {
+        const Profiler::GpuScope scope{profiler, cmd, "upscale"};
+        record_upscale(
+          cmd,
+          render_graph.get_image(scene),
+          scene_extent,
+          render_graph.get_image(target),
+          extent
+        );
+      }
+    );
   }
 
-  vk::SwapchainCreateInfoKHR swap_chain_create_info{
-    .flags = vk::SwapchainCreateFlagsKHR(),
-    .surface = surface,
-    .minImageCount = min_image_count,
-    .imageFormat = swap_chain_surface_format.format,
-    .imageColorSpace = swap_chain_surface_format.colorSpace,
-    .imageExtent = swap_chain_extent,
-    .imageArrayLayers = 1,
-    .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
-    .imageSharingMode = vk::SharingMode::eExclusive,
-    .preTransform = surface_capabilities.currentTransform,
-    .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-    .presentMode = choose_swap_surface_present_mode(presentation_modes),
-    .clipped = true,
-    .oldSwapchain = nullptr
+  // only the first output is captured
+  const Option<u32> capture_slot{
+    capture.is_enabled() and first_target.is_some()
+      ? capture.begin(
+          frame_number + 1,
+          outputs.front().extent,
+          swap_chain_image_format
+        )
+      : crab::none
   };
 
-  swap_chain_image_format = swap_chain_create_info.imageFormat;
+  if (capture_slot.is_some()) {
+    const RenderGraph::ResourceId target{first_target.get_unchecked()};
+
+    // writes nothing the graph knows of, the host reads it once the frame
+    // has retired
+    render_graph.add_pass(
+      "capture",
+      {{.resource = target, .access = RenderGraph::TRANSFER_READ}},
+      [this, target, slot = capture_slot.get_unchecked()](
+        const vk::raii::CommandBuffer& cmd
+      ) {
+        const Profiler::GpuScope scope{profiler, cmd, "capture"};
+        capture.record(cmd, slot, render_graph.get_image(target));
+      },
+      true
+    );
+  }
 
-  swap_chain = vk::raii::SwapchainKHR(device, swap_chain_create_info);
-  swap_chain_images = swap_chain.getImages();
+  render_graph.compile();
+  render_graph.execute(cmd);
 }
 
-auto App::choose_swap_surface_format(
-  const std::vector<vk::SurfaceFormatKHR>& available_formats
-) -> vk::SurfaceFormatKHR {
-  for (const vk::SurfaceFormatKHR& format: available_formats) {
-    if (format.format != vk::Format::eB8G8R8A8Srgb) {
-      continue;
-    }
+auto App::record_upscale(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::Image source,
+  const vk::Extent2D source_extent,
+  const vk::Image target,
+  const vk::Extent2D target_extent
+) const -> void {
+  constexpr vk::ImageSubresourceLayers COLOR_LAYER{
+    .aspectMask = vk::ImageAspectFlagBits::eColor,
+    .mipLevel = 0,
+    .baseArrayLayer = 0,
+    .layerCount = 1,
+  };
 
-    if (format.colorSpace != vk::ColorSpaceKHR::eSrgbNonlinear) {
-      continue;
-    }
+  const auto corner = [](const vk::Extent2D extent) -> vk::Offset3D {
+    return {
+      static_cast<i32>(extent.width),
+      static_cast<i32>(extent.height),
+      1,
+    };
+  };
+
+  const vk::ImageBlit2 region{
+    .srcSubresource = COLOR_LAYER,
+    .srcOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(source_extent)},
+    .dstSubresource = COLOR_LAYER,
+    .dstOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(target_extent)},
+  };
+
+  cmd.blitImage2({
+    .srcImage = source,
+    .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+    .dstImage = target,
+    .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+    .regionCount = 1,
+    .pRegions = &region,
+    .filter = scale_filter,
+  });
+}
+
+auto App::record_draw_pass(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::ImageView target,
+  const vk::Extent2D extent
+) -> void {
+  const vk::RenderingAttachmentInfo color_attachment{
+    .imageView = target,
+    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+    .loadOp = vk::AttachmentLoadOp::eClear,
+    .storeOp = vk::AttachmentStoreOp::eStore,
+    .clearValue = vk::ClearColorValue{0.0f, 0.0f, 0.0f, 1.0f},
+  };
+
+  const vk::RenderingInfo rendering_info{
+    .renderArea = {.offset = {0, 0}, .extent = extent},
+    .layerCount = 1,
+    .colorAttachmentCount = 1,
+    .pColorAttachments = &color_attachment,
+  };
+
+  const u32 slice_count{std::min(
+    jobs->thread_count(),
+    (instance_count + MIN_OBJECTS_PER_SLICE - 1) / MIN_OBJECTS_PER_SLICE
+  )};
+
+  if (config.gpu_driven) {
+    cmd.beginRendering(rendering_info);
+    bind_draw_state(cmd, extent);
+    cull_pass.record_draw(cmd);
+    record_particles(cmd);
+    cmd.endRendering();
+  } else if (slice_count <= 1) {
+    cmd.beginRendering(rendering_info);
+    record_draws(cmd, extent, 0, instance_count);
+    record_particles(cmd);
+    cmd.endRendering();
+  } else {
+    const vk::CommandBufferInheritanceRenderingInfo inheritance_rendering{
+      .colorAttachmentCount = 1,
+      .pColorAttachmentFormats = &swap_chain_image_format,
+      .rasterizationSamples = vk::SampleCountFlagBits::e1,
+    };
+
+    const vk::CommandBufferInheritanceInfo inheritance{
+      .pNext = &inheritance_rendering,
+    };
+
+    const u32 per_slice{(instance_count + slice_count - 1) / slice_count};
+
+    // the particles get a slice of their own after the objects', as nothing
+    // else may be recorded inside the secondaries' rendering
+    const u32 recorded_slices{slice_count + (particles.is_enabled() ? 1 : 0)};
+
+    // each worker records a contiguous range of objects, stitched back
+    // together in order below
+    const Vec<vk::CommandBuffer> secondaries{recorder.record(
+      static_cast<u32>(frame_number % frames.size()),
+      recorded_slices,
+      inheritance,
+      [&](const vk::raii::CommandBuffer& secondary, const u32 slice) {
+        if (slice == slice_count) {
+          bind_draw_state(secondary, extent);
+          record_particles(secondary);
+          return;
+        }
+
+        const u32 first{slice * per_slice};
+        const u32 count{std::min(per_slice, instance_count - first)};
+        record_draws(secondary, extent, first, count);
+      }
+    )};
+
+    vk::RenderingInfo secondary_rendering_info{rendering_info};
+    secondary_rendering_info.flags =
+      vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+
+    cmd.beginRendering(secondary_rendering_info);
+    cmd.executeCommands(secondaries);
+    cmd.endRendering();
+  }
+}
+
+auto App::record_particles(const vk::raii::CommandBuffer& cmd) const
+  -> void {
+  if (particles.is_enabled()) {
+    particles.record_draw(cmd, mesh.index_count);
+  }
+}
+
+auto App::record_draws(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::Extent2D extent,
+  const u32 first_object,
+  const u32 object_count
+) const -> void {
+  // secondaries inherit nothing but the attachments, so everything is bound
+  // again per command buffer
+  bind_draw_state(cmd, extent);
+
+  for (u32 i = first_object; i < first_object + object_count; i++) {
+    cmd.drawIndexed(mesh.index_count, 1, 0, 0, i);
+  }
+}
+
+auto App::bind_draw_state(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::Extent2D extent
+) const -> void {
+  if (shader_object) {
+    shader_objects->bind(cmd, extent);
+  } else {
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, current_pipeline);
+    cmd.setViewport(
+      0,
+      vk::Viewport{
+        0.0f,
+        0.0f,
+        static_cast<f32>(extent.width),
+        static_cast<f32>(extent.height),
+        0.0f,
+        1.0f
+      }
+    );
+    cmd.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+  }
+
+  // the shader objects are created against the heap's layout as well
+  bindless.bind(cmd, vk::PipelineBindPoint::eGraphics);
+  uniform_ring.bind(
+    cmd,
+    vk::PipelineBindPoint::eGraphics,
+    *bindless.get_pipeline_layout(),
+    draw_constants_offset
+  );
+
+  cmd.bindVertexBuffers(
+    0,
+    {*mesh.vertex_buffer.get(), *instance_buffer.get()},
+    {0, 0}
+  );
+  cmd.bindIndexBuffer(mesh.index_buffer.get(), 0, INDEX_TYPE);
+}
+
+auto App::submit_async_uploads(FrameData& frame, const u64 value) -> bool {
+  // uploads into buffers already in use stay on the graphics queue
+  if (frame.transfer_command_buffer == nullptr
+      or not staging_ring.has_pending_first_uploads()) {
+    return false;
+  }
+
+  const vk::raii::CommandBuffer& cmd{frame.transfer_command_buffer};
+
+  cmd.reset();
+  cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+  pending_acquires = staging_ring.flush(
+    cmd,
+    value,
+    StagingRing::QueueTransfer{
+      .src_family = queue_families.transfer.get_unchecked(),
+      .dst_family = queue_families.graphics,
+    }
+  );
+
+  cmd.end();
+
+  const vk::CommandBufferSubmitInfo command_buffer_info{
+    .commandBuffer = cmd,
+  };
+
+  const vk::SemaphoreSubmitInfo signal_info{
+    .semaphore = transfer_timeline,
+    .value = value,
+    .stageMask = vk::PipelineStageFlagBits2::eCopy,
+  };
+
+  transfer_queue.submit2(vk::SubmitInfo2{
+    .commandBufferInfoCount = 1,
+    .pCommandBufferInfos = &command_buffer_info,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos = &signal_info,
+  });
+
+  return true;
+}
+
+auto App::submit_async_compute(FrameData& frame, const u64 value) -> bool {
+  if (not particles.is_enabled()) {
+    return false;
+  }
+
+  const vk::raii::CommandBuffer& cmd{frame.compute_command_buffer};
+
+  cmd.reset();
+  cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  particles.record_simulate(cmd, value);
+  cmd.end();
+
+  const vk::CommandBufferSubmitInfo command_buffer_info{
+    .commandBuffer = cmd,
+  };
+
+  // the instances this step writes were last drawn by the frame
+  // OUTPUT_COUNT before it, a value of 0 is already reached
+  const vk::SemaphoreSubmitInfo wait_info{
+    .semaphore = frame_timeline,
+    .value = value > ParticleSystem::OUTPUT_COUNT
+             ? value - ParticleSystem::OUTPUT_COUNT
+             : 0,
+    .stageMask = vk::PipelineStageFlagBits2::eComputeShader,
+  };
+
+  const vk::SemaphoreSubmitInfo signal_info{
+    .semaphore = compute_timeline,
+    .value = value,
+    .stageMask = vk::PipelineStageFlagBits2::eComputeShader,
+  };
+
+  compute_queue.submit2(vk::SubmitInfo2{
+    .waitSemaphoreInfoCount = 1,
+    .pWaitSemaphoreInfos = &wait_info,
+    .commandBufferInfoCount = 1,
+    .pCommandBufferInfos = &command_buffer_info,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos = &signal_info,
+  });
+
+  return true;
+}
+
+auto App::cleanup() -> void {
+  shader_watcher.reset();
+  pipelines.clear();
+  deletion_queue.flush();
+  pending_shaders.reset();
+  pending_shader_objects.reset();
+  shader_objects.reset();
+  pipeline_cache.save();
+  pipeline_cache.log_stats();
+  pipeline_cache.clear();
+
+  for (Output& output: outputs) {
+    output.image_views.clear();
+    output.swap_chain.clear();
+    output.offscreen_images.clear();
+    output.image_available.clear();
+    output.render_finished.clear();
+  }
+
+  mesh = {};
+  profiler.log_stats();
+
+  if (not config.trace_path.empty()) {
+    profiler.write_trace(config.trace_path);
+  }
+
+  profiler.clear();
+  capture.clear();
+  render_graph.clear();
+  cull_pass.clear();
+  particles.clear();
+  bindless.clear();
+  instance_buffer.reset();
+  recorder.clear();
+  staging_ring.clear();
+  uniform_ring.clear();
+  frames.clear();
+  frame_timeline.clear();
+  transfer_timeline.clear();
+  compute_timeline.clear();
+  command_pool.clear();
+  transfer_command_pool.clear();
+  compute_command_pool.clear();
+  transfer_queue.clear();
+  compute_queue.clear();
+  graphics_queue.clear();
+
+  allocator.log_stats();
+  allocator.clear();
+
+  device.clear();
+  jobs.reset();
+
+  for (Output& output: outputs) {
+    output.surface.clear();
+  }
+
+  physical_device.clear();
+
+  // after everything that can still report through it
+  debug_messenger.clear();
+  debug_log.stop();
+
+  if (config.headless) {
+    return;
+  }
+
+  spdlog::info("Killing window(s)");
+
+  for (const Output& output: outputs) {
+    glfwDestroyWindow(output.window);
+  }
+
+  //
+  spdlog::info("Terminating GLFW");
+  glfwTerminate();
+}
+
+auto App::get_required_extensions() const -> Vec<const char*> {
+  Vec<const char*> extensions{};
+
+  // headless rendering never presents, so no surface extensions are needed
+  if (not config.headless) {
+    u32 extension_count = 0;
+    Span<const char*> glfw_extensions{
+      glfwGetRequiredInstanceExtensions(&extension_count),
+      extension_count,
+    };
+
+    extensions.assign(glfw_extensions.begin(), glfw_extensions.end());
+  }
+
+  if (ENABLE_VALIDATION_LAYERS) {
+    extensions.push_back(vk::EXTDebugUtilsExtensionName);
+  }
+
+#if _OSX
+  extensions.push_back(vk::KHRPortabilityEnumerationExtensionName);
+
+  if (not config.headless) {
+    extensions.push_back("VK_EXT_metal_surface");
+    extensions.push_back(vk::KHRSurfaceExtensionName);
+  }
+#endif
+
+  return extensions;
+}
+
+auto App::get_device_extensions() const -> Vec<const char*> {
+  Vec<const char*> extensions{};
+
+  for (const char* extension: DEVICE_EXTENSIONS) {
+    if (config.headless
+        and StringView{extension} == vk::KHRSwapchainExtensionName) {
+      continue;
+    }
+
+    extensions.push_back(extension);
+  }
+
+  if (pipeline_library) {
+    extensions.insert(
+      extensions.end(),
+      PIPELINE_LIBRARY_EXTENSIONS.begin(),
+      PIPELINE_LIBRARY_EXTENSIONS.end()
+    );
+  }
+
+  if (shader_object) {
+    extensions.insert(
+      extensions.end(),
+      SHADER_OBJECT_EXTENSIONS.begin(),
+      SHADER_OBJECT_EXTENSIONS.end()
+    );
+  }
+
+  return extensions;
+}
+
+auto App::setup_debug_messenger() -> void {
+  if (not ENABLE_VALIDATION_LAYERS) {
+    return;
+  }
+  spdlog::info("Setting up debug messenger");
+
+  constexpr vk::DebugUtilsMessageSeverityFlagsEXT SEVERITY_FLAGS{
+    vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose
+    | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning
+    | vk::DebugUtilsMessageSeverityFlagBitsEXT::eError
+  };
+
+  constexpr vk::DebugUtilsMessageTypeFlagsEXT MESSAGE_TYPE_FLAGS =
+    vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral
+    | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance
+    | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation;
+
+  const vk::DebugUtilsMessengerCreateInfoEXT debug_utils_create_info{
+    .messageSeverity = SEVERITY_FLAGS,
+    .messageType = MESSAGE_TYPE_FLAGS,
+    .pfnUserCallback = &DebugLog::callback,
+    .pUserData = &debug_log,
+  };
+
+  debug_log.start();
+  debug_messenger =
+    instance.createDebugUtilsMessengerEXT(debug_utils_create_info);
+}
+
+auto App::pick_physical_device() -> void {
+  assert(instance != nullptr);
+  spdlog::info("Picking physical device");
+
+  Vec<vk::raii::PhysicalDevice> devices = instance.enumeratePhysicalDevices();
+
+  if (devices.empty()) {
+    throw std::runtime_error{"Could not find a GPU with Vulkan support"};
+  }
+
+  for (vk::raii::PhysicalDevice& device: devices) {
+    if (not is_device_suitable(device)) {
+      continue;
+    }
+
+    const vk::PhysicalDeviceProperties properties{device.getProperties()};
+    const StringView name{properties.deviceName};
+
+    if (not config.preferred_device.empty()
+        and name.find(config.preferred_device) == StringView::npos) {
+      // keep the first suitable device as a fallback
+      if (physical_device == nullptr) {
+        physical_device = std::move(device);
+      }
+      continue;
+    }
+
+    physical_device = std::move(device);
+    break;
+  }
+
+  if (physical_device == nullptr) {
+    throw std::runtime_error{
+      "Could not find any suitable GPU's (Graphics Support)"
+    };
+  }
+
+  device_name = String{physical_device.getProperties().deviceName.data()};
+
+  if (config.require_preferred_device
+      and device_name.find(config.preferred_device) == String::npos) {
+    throw std::runtime_error{fmt::format(
+      "No suitable GPU matches '{}', the first suitable one is '{}'",
+      config.preferred_device,
+      device_name
+    )};
+  }
+
+  spdlog::info("Using physical device '{}'", device_name);
+
+  pipeline_library = supports_pipeline_library(physical_device);
+  spdlog::info(
+    "Graphics pipeline library {}",
+    pipeline_library ? "supported" : "not supported"
+  );
+
+  if (config.shader_objects) {
+    shader_object = supports_shader_object(physical_device);
+
+    if (not shader_object) {
+      spdlog::warn("Shader objects are not supported, drawing with pipelines");
+    }
+  }
+}
+
+auto App::is_device_suitable(const vk::raii::PhysicalDevice& device) const
+  -> bool {
+  const vk::PhysicalDeviceProperties properties{device.getProperties()};
+
+  if (properties.apiVersion < VK_API_VERSION_1_3) {
+    spdlog::trace("Unsupporetd API version");
+    return false;
+  }
+
+  const bool has_queue_family = QueueFamilies::find(device).is_some();
+
+  if (not has_queue_family) {
+    spdlog::trace("No queue family found");
+    return false;
+  }
+
+  const auto features = device.getFeatures2<
+    vk::PhysicalDeviceFeatures2,
+    vk::PhysicalDeviceVulkan12Features>();
+
+  const vk::PhysicalDeviceVulkan12Features& vulkan12{
+    features.get<vk::PhysicalDeviceVulkan12Features>()
+  };
+
+  // everything BindlessHeap relies on
+  if (not vulkan12.descriptorIndexing
+      or not vulkan12.descriptorBindingSampledImageUpdateAfterBind
+      or not vulkan12.descriptorBindingStorageBufferUpdateAfterBind
+      or not vulkan12.descriptorBindingUpdateUnusedWhilePending
+      or not vulkan12.descriptorBindingPartiallyBound
+      or not vulkan12.runtimeDescriptorArray) {
+    spdlog::trace("No bindless descriptor indexing");
+    return false;
+  }
+
+  if (config.gpu_driven) {
+    const vk::PhysicalDeviceFeatures& core{
+      features.get<vk::PhysicalDeviceFeatures2>().features
+    };
+
+    if (not core.multiDrawIndirect or not core.drawIndirectFirstInstance
+        or not vulkan12.drawIndirectCount) {
+      spdlog::trace("No indirect count draws");
+      return false;
+    }
+  }
+
+  const Vec<vk::ExtensionProperties> extensions{
+    device.enumerateDeviceExtensionProperties()
+  };
+
+  for (const StringView extension: get_device_extensions()) {
+    const bool is_supported = ranges::any_of(
+      extensions,
+      [extension](const vk::ExtensionProperties& requested) {
+        return requested.extensionName == extension;
+      }
+    );
+
+    if (not is_supported) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto App::supports_extensions(
+  const vk::raii::PhysicalDevice& device,
+  const Span<const char* const> extensions
+) -> bool {
+  const Vec<vk::ExtensionProperties> available{
+    device.enumerateDeviceExtensionProperties()
+  };
+
+  return ranges::all_of(extensions, [&](const StringView extension) {
+    return ranges::any_of(
+      available,
+      [extension](const vk::ExtensionProperties& properties) {
+        return properties.extensionName == extension;
+      }
+    );
+  });
+}
+
+auto App::supports_pipeline_library(const vk::raii::PhysicalDevice& device)
+  -> bool {
+  if (not supports_extensions(device, PIPELINE_LIBRARY_EXTENSIONS)) {
+    return false;
+  }
+
+  const auto features = device.getFeatures2<
+    vk::PhysicalDeviceFeatures2,
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+
+  return features.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>()
+    .graphicsPipelineLibrary;
+}
+
+auto App::supports_shader_object(const vk::raii::PhysicalDevice& device)
+  -> bool {
+  if (not supports_extensions(device, SHADER_OBJECT_EXTENSIONS)) {
+    return false;
+  }
+
+  const auto features = device.getFeatures2<
+    vk::PhysicalDeviceFeatures2,
+    vk::PhysicalDeviceShaderObjectFeaturesEXT>();
+
+  return features.get<vk::PhysicalDeviceShaderObjectFeaturesEXT>()
+    .shaderObject;
+}
+
+auto App::create_frame_capture() -> void {
+  if (config.capture_path.empty()) {
+    return;
+  }
+
+  if (not FrameCapture::is_supported(swap_chain_image_format)) {
+    spdlog::warn(
+      "Cannot capture {} images, frame capture is disabled",
+      vk::to_string(swap_chain_image_format)
+    );
+    return;
+  }
+
+  capture.init(
+    allocator,
+    {.directory = config.capture_path, .format = config.capture_format}
+  );
+}
+
+auto App::create_logical_device() -> void {
+  spdlog::info("Creating logical device");
+
+  const Option<QueueFamilies> families{QueueFamilies::find(physical_device)};
+
+  if (families.is_none()) {
+    throw std::runtime_error{
+      std::format("Could not find graphics queue family for device")
+    };
+  }
+
+  queue_families = families.get_unchecked();
+
+  spdlog::info(
+    "Queue families: graphics {}, compute {}, transfer {}",
+    queue_families.graphics,
+    queue_families.compute.is_some()
+      ? fmt::format("{}", queue_families.compute.get_unchecked())
+      : "shared",
+    queue_families.transfer.is_some()
+      ? fmt::format("{}", queue_families.transfer.get_unchecked())
+      : "shared"
+  );
+
+  const Vec<vk::DeviceQueueCreateInfo> queue_create_infos{
+    queue_families.queue_create_infos()
+  };
+
+  // indirect draws start at their instance and come many to a call
+  const vk::PhysicalDeviceFeatures core_features{
+    .multiDrawIndirect = config.gpu_driven,
+    .drawIndirectFirstInstance = config.gpu_driven,
+  };
+
+  vk::StructureChain<
+    vk::PhysicalDeviceFeatures2,
+    vk::PhysicalDeviceVulkan12Features,
+    vk::PhysicalDeviceVulkan13Features,
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT,
+    vk::PhysicalDeviceShaderObjectFeaturesEXT>
+    feature_name{
+      {.features = core_features},
+      {
+        .drawIndirectCount = config.gpu_driven,
+        .descriptorIndexing = true,
+        .descriptorBindingSampledImageUpdateAfterBind = true,
+        .descriptorBindingStorageBufferUpdateAfterBind = true,
+        .descriptorBindingUpdateUnusedWhilePending = true,
+        .descriptorBindingPartiallyBound = true,
+        .runtimeDescriptorArray = true,
+        .timelineSemaphore = true,
+      },
+      {.synchronization2 = true, .dynamicRendering = true},
+      {.extendedDynamicState = true},
+      {.graphicsPipelineLibrary = true},
+      {.shaderObject = true}
+    };
+
+  // chaining features of an extension that is not enabled is invalid
+  if (not pipeline_library) {
+    feature_name.unlink<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+  }
+
+  if (not shader_object) {
+    feature_name.unlink<vk::PhysicalDeviceShaderObjectFeaturesEXT>();
+  }
+
+  const Vec<const char*> device_extensions{get_device_extensions()};
+
+  vk::DeviceCreateInfo device_create_info{
+    .pNext = &feature_name.get<vk::PhysicalDeviceFeatures2>(),
+    .queueCreateInfoCount = static_cast<u32>(queue_create_infos.size()),
+    .pQueueCreateInfos = queue_create_infos.data(),
+    .enabledExtensionCount = static_cast<u32>(device_extensions.size()),
+    .ppEnabledExtensionNames = device_extensions.data()
+
+  };
+
+  device = vk::raii::Device{
+    physical_device,
+    device_create_info,
+  };
+
+  graphics_index = queue_families.graphics;
+  graphics_queue = vk::raii::Queue{
+    device,
+    graphics_index,
+    0,
+  };
+  compute_queue = vk::raii::Queue{
+    device,
+    queue_families.compute_or_graphics(),
+    0,
+  };
+  transfer_queue = vk::raii::Queue{
+    device,
+    queue_families.transfer_or_graphics(),
+    0,
+  };
+}
+
+auto App::create_job_system() -> void {
+  jobs = std::make_unique<JobSystem>(config.worker_threads);
+}
+
+auto App::create_profiler() -> void {
+  profiler.init_gpu(
+    device,
+    physical_device,
+    graphics_index,
+    config.frames_in_flight
+  );
+}
+
+auto App::create_allocator() -> void {
+  allocator.init(device, physical_device, config.frames_in_flight);
+}
+
+auto App::create_staging_ring() -> void {
+  const vk::DeviceSize copy_alignment{
+    physical_device.getProperties().limits.optimalBufferCopyOffsetAlignment
+  };
+
+  staging_ring.init(
+    allocator,
+    StagingRing::DEFAULT_SIZE,
+    std::max<vk::DeviceSize>(copy_alignment, 16)
+  );
+}
+
+auto App::create_vertex_buffers() -> void {
+  spdlog::info("Creating vertex buffers");
+
+  const std::array VERTICES{
+    Vertex{.position = {0.0f, -0.5f}, .color = {1.0f, 0.0f, 0.0f}},
+    Vertex{.position = {0.5f, 0.5f}, .color = {0.0f, 1.0f, 0.0f}},
+    Vertex{.position = {-0.5f, 0.5f}, .color = {0.0f, 0.0f, 1.0f}},
+  };
+
+  constexpr std::array<Index, 3> INDICES{0, 1, 2};
+
+  mesh.vertex_buffer = allocator.create_buffer(
+    {
+      .size = sizeof(VERTICES),
+      .usage = vk::BufferUsageFlagBits::eVertexBuffer
+             | vk::BufferUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  mesh.index_buffer = allocator.create_buffer(
+    {
+      .size = sizeof(INDICES),
+      .usage = vk::BufferUsageFlagBits::eIndexBuffer
+             | vk::BufferUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  mesh.index_count = INDICES.size();
+  mesh.bounds_radius = ranges::max(
+    VERTICES | views::transform([](const Vertex& vertex) {
+      return glm::length(vertex.position);
+    })
+  );
+
+  // copied by the first frame's command buffer, no queue wait needed
+  const bool queued =
+    staging_ring.upload(Span<const Vertex>{VERTICES}, mesh.vertex_buffer.get())
+    and staging_ring.upload(Span<const Index>{INDICES}, mesh.index_buffer.get()
+    );
+
+  if (not queued) {
+    throw std::runtime_error{"Staging ring is too small for the mesh"};
+  }
+}
+
+auto App::create_instance_buffer() -> void {
+  instance_count = std::max(config.object_count, 1u);
+  spdlog::info("Creating {} object instances", instance_count);
+
+  // lay the objects out on a square grid covering the viewport
+  const auto columns =
+    static_cast<u32>(std::ceil(std::sqrt(static_cast<f32>(instance_count))));
+  const f32 cell{2.0f / static_cast<f32>(columns)};
+
+  Vec<InstanceData> instances{};
+  instances.reserve(instance_count);
+
+  for (u32 i = 0; i < instance_count; i++) {
+    instances.push_back({
+      .offset = {
+        -1.0f + (static_cast<f32>(i % columns) + 0.5f) * cell,
+        -1.0f + (static_cast<f32>(i / columns) + 0.5f) * cell,
+      },
+      .scale = std::min(1.0f, cell * 0.9f),
+    });
+  }
+
+  instance_buffer = allocator.create_buffer(
+    {
+      .size = instances.size() * sizeof(InstanceData),
+      .usage = vk::BufferUsageFlagBits::eVertexBuffer
+             | vk::BufferUsageFlagBits::eStorageBuffer
+             | vk::BufferUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  if (not staging_ring.upload(
+        Span<const InstanceData>{instances},
+        instance_buffer.get()
+      )) {
+    throw std::runtime_error{"Staging ring is too small for the instances"};
+  }
+}
+
+auto App::create_cull_pass() -> void {
+  cull_pass.init(
+    device,
+    allocator,
+    pipeline_cache,
+    bindless,
+    shaders::CULL,
+    instance_buffer.get(),
+    {
+      .instance_count = instance_count,
+      .index_count = mesh.index_count,
+      .bounds_radius = mesh.bounds_radius,
+    }
+  );
+}
+
+auto App::create_particle_system() -> void {
+  particles.init(
+    device,
+    allocator,
+    pipeline_cache,
+    bindless,
+    shaders::PARTICLES,
+    {
+      .particle_count = config.particle_count,
+      .graphics_family = queue_families.graphics,
+      .compute_family = queue_families.compute_or_graphics(),
+    }
+  );
+}
+
+auto App::create_uniform_ring() -> void {
+  uniform_ring.init(device, physical_device, allocator);
+}
+
+auto App::create_bindless_heap() -> void {
+  const std::array extra_set_layouts{uniform_ring.get_set_layout()};
+  bindless.init(device, physical_device, extra_set_layouts);
+}
+
+auto App::create_pipeline_cache() -> void {
+  spdlog::info("Opening pipeline cache");
+  pipeline_cache.open(device, physical_device, config.pipeline_cache_path);
+}
+
+auto App::choose_swap_chain_format() -> void {
+  if (config.headless) {
+    swap_chain_surface_format = {
+      .format = HEADLESS_IMAGE_FORMAT,
+      .colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear,
+    };
+  } else {
+    swap_chain_surface_format = choose_swap_surface_format(
+      physical_device.getSurfaceFormatsKHR(outputs.front().surface)
+    );
+  }
+
+  swap_chain_image_format = swap_chain_surface_format.format;
+
+  // one set of pipelines draws into every output, so they all have to take
+  // the first one's format
+  for (const Output& output: outputs | std::views::drop(1)) {
+    const Vec<vk::SurfaceFormatKHR> formats{
+      physical_device.getSurfaceFormatsKHR(output.surface)
+    };
+
+    if (ranges::find(formats, swap_chain_surface_format) == formats.end()) {
+      throw std::runtime_error{fmt::format(
+        "Window surface '{}' does not support {}",
+        output.name,
+        vk::to_string(swap_chain_image_format)
+      )};
+    }
+  }
+
+  if (config.render_scale == 1.0f) {
+    return;
+  }
+
+  const vk::FormatFeatureFlags features{
+    physical_device.getFormatProperties(swap_chain_image_format)
+      .optimalTilingFeatures
+  };
+  constexpr vk::FormatFeatureFlags BLIT{
+    vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst
+  };
+
+  if ((features & BLIT) != BLIT) {
+    spdlog::warn(
+      "{} cannot be blitted, ignoring the render scale",
+      vk::to_string(swap_chain_image_format)
+    );
+    config.render_scale = 1.0f;
+    return;
+  }
+
+  scale_filter = features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear
+                 ? vk::Filter::eLinear
+                 : vk::Filter::eNearest;
+}
+
+auto App::create_swap_chains() -> void {
+  for (Output& output: outputs) {
+    create_swap_chain(output);
+  }
+}
+
+auto App::create_swap_chain(Output& output) -> void {
+  if (config.headless) {
+    create_offscreen_images(output);
+    return;
+  }
+
+  const vk::SurfaceCapabilitiesKHR surface_capabilities{
+    physical_device.getSurfaceCapabilitiesKHR(output.surface)
+  };
+
+  const Vec<vk::PresentModeKHR> presentation_modes{
+    physical_device.getSurfacePresentModesKHR(output.surface)
+  };
+
+  output.present_mode = choose_swap_surface_present_mode(
+    presentation_modes,
+    latency.present_modes
+  );
+  output.extent = choose_swap_extent(surface_capabilities, output.window);
+
+  u32 image_count{
+    std::max(latency.image_count, surface_capabilities.minImageCount)
+  };
+
+  if (surface_capabilities.maxImageCount > 0) {
+    image_count = std::min(image_count, surface_capabilities.maxImageCount);
+  }
+
+  vk::ImageUsageFlags image_usage{vk::ImageUsageFlagBits::eColorAttachment};
+
+  // frame capture copies out of the swapchain images
+  if (not config.capture_path.empty()) {
+    if (surface_capabilities.supportedUsageFlags
+        & vk::ImageUsageFlagBits::eTransferSrc) {
+      image_usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    } else {
+      spdlog::warn("Swapchain images cannot be copied from, not capturing");
+      config.capture_path.clear();
+    }
+  }
+
+  // a scaled scene is blitted into the swapchain images
+  if (config.render_scale != 1.0f) {
+    if (surface_capabilities.supportedUsageFlags
+        & vk::ImageUsageFlagBits::eTransferDst) {
+      image_usage |= vk::ImageUsageFlagBits::eTransferDst;
+    } else {
+      spdlog::warn(
+        "Swapchain images cannot be blitted to, ignoring the render scale"
+      );
+      config.render_scale = 1.0f;
+    }
+  }
+
+  vk::SwapchainCreateInfoKHR swap_chain_create_info{
+    .flags = vk::SwapchainCreateFlagsKHR(),
+    .surface = output.surface,
+    .minImageCount = image_count,
+    .imageFormat = swap_chain_surface_format.format,
+    .imageColorSpace = swap_chain_surface_format.colorSpace,
+    .imageExtent = output.extent,
+    .imageArrayLayers = 1,
+    .imageUsage = image_usage,
+    .imageSharingMode = vk::SharingMode::eExclusive,
+    .preTransform = surface_capabilities.currentTransform,
+    .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
+    .presentMode = output.present_mode,
+    .clipped = true,
+    .oldSwapchain = *output.swap_chain,
+  };
+
+  vk::raii::SwapchainKHR new_swap_chain{device, swap_chain_create_info};
+
+  if (output.swap_chain != nullptr) {
+    // retired by the handoff, but frames in flight may still render to or
+    // present its images
+    deletion_queue.push(frame_number + 1, std::move(output.swap_chain));
+  }
+
+  output.swap_chain = std::move(new_swap_chain);
+  output.images = output.swap_chain.getImages();
+}
+
+auto App::recreate_swap_chain(Output& output) -> bool {
+  i32 width{0}, height{0};
+  glfwGetFramebufferSize(output.window, &width, &height);
+
+  if (width == 0 or height == 0) {
+    return false;
+  }
+
+  output.dirty = false;
+
+  // the last submission that can touch the old images is frame_number, but
+  // its present is only known to be done once the next submission is
+  const u64 retire_value{frame_number + 1};
+
+  deletion_queue.push(retire_value, std::move(output.image_views));
+  deletion_queue.push(retire_value, std::move(output.render_finished));
+  output.image_views.clear();
+  output.render_finished.clear();
+
+  // the surface format is kept, so the graphics pipeline and the secondary
+  // command buffer inheritance stay valid
+  create_swap_chain(output);
+  create_image_views(output);
+  create_present_semaphores(output);
+
+  spdlog::info(
+    "Recreated {} swapchain at {}x{} with {} images",
+    output.name,
+    output.extent.width,
+    output.extent.height,
+    output.images.size()
+  );
+
+  return true;
+}
+
+auto App::create_offscreen_images(Output& output) -> void {
+  const u32 image_count{
+    std::max(HEADLESS_IMAGE_COUNT, config.frames_in_flight)
+  };
+  spdlog::info("Creating {} offscreen render targets", image_count);
+
+  output.extent = {.width = WIDTH, .height = HEIGHT};
+
+  const vk::ImageCreateInfo image_create_info{
+    .imageType = vk::ImageType::e2D,
+    .format = swap_chain_image_format,
+    .extent = {output.extent.width, output.extent.height, 1},
+    .mipLevels = 1,
+    .arrayLayers = 1,
+    .samples = vk::SampleCountFlagBits::e1,
+    .tiling = vk::ImageTiling::eOptimal,
+    .usage = vk::ImageUsageFlagBits::eColorAttachment
+           | vk::ImageUsageFlagBits::eTransferSrc
+           | vk::ImageUsageFlagBits::eTransferDst,
+    .sharingMode = vk::SharingMode::eExclusive,
+    .initialLayout = vk::ImageLayout::eUndefined,
+  };
+
+  output.offscreen_images.clear();
+  output.images.clear();
+
+  for (u32 i = 0; i < image_count; i++) {
+    const GpuImage& image{
+      output.offscreen_images.emplace_back(allocator.create_image(
+        image_create_info,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+      ))
+    };
+
+    output.images.push_back(image.get());
+  }
+}
+
+auto App::choose_swap_surface_format(
+  const std::vector<vk::SurfaceFormatKHR>& available_formats
+) -> vk::SurfaceFormatKHR {
+  for (const vk::SurfaceFormatKHR& format: available_formats) {
+    if (format.format != vk::Format::eB8G8R8A8Srgb) {
+      continue;
+    }
+
+    if (format.colorSpace != vk::ColorSpaceKHR::eSrgbNonlinear) {
+      continue;
+    }
 
     return format;
   }
@@ -476,18 +2012,23 @@ auto App::choose_swap_surface_format(
 }
 
 auto App::choose_swap_surface_present_mode(
-  const Vec<vk::PresentModeKHR>& available_modes
+  const Vec<vk::PresentModeKHR>& available_modes,
+  const Span<const vk::PresentModeKHR> preferred_modes
 ) -> vk::PresentModeKHR {
-  for (const auto& mode: available_modes) {
-    if (mode == vk::PresentModeKHR::eMailbox) {
+  for (const vk::PresentModeKHR mode: preferred_modes) {
+    if (ranges::find(available_modes, mode) != available_modes.end()) {
       return mode;
     }
   }
+
+  // the only mode every surface has to support
   return vk::PresentModeKHR::eFifo;
 }
 
-auto App::choose_swap_extent(const vk::SurfaceCapabilitiesKHR& capabilities)
-  -> vk::Extent2D {
+auto App::choose_swap_extent(
+  const vk::SurfaceCapabilitiesKHR& capabilities,
+  GLFWwindow* window
+) -> vk::Extent2D {
   if (capabilities.currentExtent.width != std::numeric_limits<u32>::max()) {
     return capabilities.currentExtent;
   }
@@ -509,8 +2050,14 @@ auto App::choose_swap_extent(const vk::SurfaceCapabilitiesKHR& capabilities)
   };
 }
 
-auto App::create_image_view() -> void {
-  swap_chain_image_views.clear();
+auto App::create_image_views() -> void {
+  for (Output& output: outputs) {
+    create_image_views(output);
+  }
+}
+
+auto App::create_image_views(Output& output) -> void {
+  output.image_views.clear();
 
   const vk::ImageSubresourceRange subresource_range{
     .aspectMask = vk::ImageAspectFlagBits::eColor,
@@ -526,162 +2073,260 @@ auto App::create_image_view() -> void {
     .subresourceRange = subresource_range
   };
 
-  for (const vk::Image& image: swap_chain_images) {
+  for (const vk::Image& image: output.images) {
     image_view_create_info.image = image;
-    swap_chain_image_views.emplace_back(device, image_view_create_info);
+    output.image_views.emplace_back(device, image_view_create_info);
   }
 }
 
 auto App::create_graphics_pipeline() -> void {
+  if (shader_object) {
+    shader_objects = std::make_shared<ShaderObjects>(
+      device,
+      bindless,
+      shaders::TRIANGLE
+    );
+
+    if (config.hot_reload) {
+      start_shader_watcher();
+    }
+    return;
+  }
+
   spdlog::info("Creating Graphics Pipeline");
-  const Vec<u8> shader_code{read_file_contents("shaders/slang.spv")};
 
-  spdlog::info("Creating shader module");
-  vk::raii::ShaderModule module = create_shader_module(shader_code);
+  pipelines.init(
+    device,
+    pipeline_cache,
+    {
+      .layout = bindless.get_pipeline_layout(),
+      .color_format = swap_chain_image_format,
+      .use_library = pipeline_library,
+    }
+  );
 
-  const vk::PipelineShaderStageCreateInfo vert_shader_stage_info{
-    .stage = vk::ShaderStageFlagBits::eVertex,
-    .module = module,
-    .pName = "vertMain"
-  };
+  // the generic pipeline, variants are compiled as frames ask for them
+  pipelines.swap(pipelines.build(shaders::TRIANGLE));
 
-  const vk::PipelineShaderStageCreateInfo frag_shader_stage_info{
-    .stage = vk::ShaderStageFlagBits::eFragment,
-    .module = module,
-    .pName = "fragMain"
-  };
+  if (config.hot_reload) {
+    start_shader_watcher();
+  }
+}
 
-  const vk::PipelineShaderStageCreateInfo stages[] = {
-    vert_shader_stage_info,
-    frag_shader_stage_info
-  };
+auto App::start_shader_watcher() -> void {
+  const std::filesystem::path shader_dir{SHADER_DIR};
 
-  constexpr std::array DYNAMIC_STATES = {
-    vk::DynamicState::eViewport,
-    vk::DynamicState::eScissor
+  ShaderWatcher::Config watcher_config{
+    .compiler = String{SLANGC_EXECUTABLE},
+    .flags = String{SLANGC_FLAGS},
+    .source_dir = shader_dir,
+    .sources = {shader_dir / "triangle.slang"},
+    .output = shader_dir / "slang.spv",
+    .entry_points = {"vertMain", "fragMain"},
   };
 
-  const vk::PipelineDynamicStateCreateInfo dynamic_state{
-    .dynamicStateCount = static_cast<uint32_t>(DYNAMIC_STATES.size()),
-    .pDynamicStates = DYNAMIC_STATES.data()
-  };
+  shader_watcher = std::make_unique<ShaderWatcher>(
+    std::move(watcher_config),
+    [this](const MappedFile& spirv) {
+      if (shader_object) {
+        auto objects =
+          std::make_shared<ShaderObjects>(device, bindless, spirv.words());
 
-  const vk::PipelineVertexInputStateCreateInfo vertex_input_info;
+        std::lock_guard lock{pending_pipeline_mutex};
+        pending_shader_objects = std::move(objects);
+        return;
+      }
 
-  const vk::PipelineInputAssemblyStateCreateInfo input_assembly{
-    .topology = vk::PrimitiveTopology::eTriangleList
-  };
+      // compiled here, on the watcher thread, so the render loop only ever
+      // sees a finished generic pipeline
+      std::shared_ptr<PipelineVariants::Shaders> shaders{
+        pipelines.build(spirv.words())
+      };
 
-  const vk::Viewport viewport{
-    0.0f,
-    0.0f,
-    static_cast<f32>(swap_chain_extent.width),
-    static_cast<f32>(swap_chain_extent.height),
-    0.0f,
-    1.0f
-  };
+      std::lock_guard lock{pending_pipeline_mutex};
+      pending_shaders = std::move(shaders);
+    }
+  );
+}
 
-  const vk::PipelineViewportStateCreateInfo viewport_state{
-    .viewportCount = 1,
-    .pViewports = &viewport,
-    .scissorCount = 1
-  };
+auto App::apply_pending_pipeline() -> void {
+  // never block the render thread on the watcher, a reload that is being
+  // published right now is picked up next frame instead
+  std::unique_lock lock{pending_pipeline_mutex, std::try_to_lock};
 
-  const vk::PipelineRasterizationStateCreateInfo rasterizer{
-    .depthClampEnable = vk::False,
-    .rasterizerDiscardEnable = vk::False,
-    .polygonMode = vk::PolygonMode::eFill,
-    .cullMode = vk::CullModeFlagBits::eBack,
-    .frontFace = vk::FrontFace::eClockwise,
-    .depthBiasEnable = vk::False,
-    .depthBiasSlopeFactor = 1.0f,
-    .lineWidth = 1.0f
-  };
+  if (not lock.owns_lock()) {
+    return;
+  }
+
+  if (pending_shader_objects != nullptr) {
+    deletion_queue.push(
+      frame_number,
+      std::exchange(shader_objects, std::move(pending_shader_objects))
+    );
+    pending_shader_objects = nullptr;
+
+    spdlog::info("Swapped in reloaded shader objects");
+    return;
+  }
+
+  if (pending_shaders == nullptr) {
+    return;
+  }
+
+  // every submission up to frame_number may still reference the old ones,
+  // variants are compiled afresh as frames ask for them
+  deletion_queue.push(
+    frame_number,
+    pipelines.swap(std::exchange(pending_shaders, nullptr))
+  );
+
+  spdlog::info("Swapped in reloaded graphics pipeline");
+}
 
-  const vk::PipelineMultisampleStateCreateInfo multisampling{
-    .rasterizationSamples = vk::SampleCountFlagBits::e1,
-    .sampleShadingEnable = vk::False,
+auto App::create_command_pool() -> void {
+  vk::CommandPoolCreateInfo pool_info{
+    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+    .queueFamilyIndex = graphics_index,
   };
 
-  const vk::PipelineColorBlendAttachmentState color_blend_attachment{
-    .blendEnable = vk::False,
-    .colorWriteMask = vk::ColorComponentFlagBits::eR //
-                    | vk::ColorComponentFlagBits::eG
-                    | vk::ColorComponentFlagBits::eB
-                    | vk::ColorComponentFlagBits::eA,
+  command_pool = vk::raii::CommandPool{device, pool_info};
+
+  if (config.particle_count > 0) {
+    compute_command_pool = vk::raii::CommandPool{
+      device,
+      vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = queue_families.compute_or_graphics(),
+      },
+    };
+  }
+
+  if (queue_families.transfer.is_none()) {
+    return;
+  }
+
+  transfer_command_pool = vk::raii::CommandPool{
+    device,
+    vk::CommandPoolCreateInfo{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex = queue_families.transfer.get_unchecked(),
+    },
   };
+}
 
-  const vk::PipelineColorBlendStateCreateInfo color_blend_state{
-    .attachmentCount = 1,
-    .pAttachments = &color_blend_attachment
+auto App::create_command_buffer() -> void {
+  const vk::CommandBufferAllocateInfo allocate_info{
+    .commandPool = command_pool,
+    .level = vk::CommandBufferLevel::ePrimary,
+    .commandBufferCount = config.frames_in_flight,
   };
 
-  vk::PipelineLayoutCreateInfo layout_info{
-    .setLayoutCount = 0,
-    .pushConstantRangeCount = 0
+  vk::raii::CommandBuffers command_buffers{device, allocate_info};
+
+  frames.clear();
+  frames.resize(config.frames_in_flight);
+
+  for (usize i = 0; i < frames.size(); i++) {
+    frames[i].command_buffer = std::move(command_buffers[i]);
+  }
+
+  recorder.init(device, *jobs, graphics_index, config.frames_in_flight);
+  render_graph.init(device, allocator, config.frames_in_flight);
+
+  if (compute_command_pool != nullptr) {
+    vk::raii::CommandBuffers compute_command_buffers{
+      device,
+      vk::CommandBufferAllocateInfo{
+        .commandPool = compute_command_pool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = config.frames_in_flight,
+      },
+    };
+
+    for (usize i = 0; i < frames.size(); i++) {
+      frames[i].compute_command_buffer =
+        std::move(compute_command_buffers[i]);
+    }
+  }
+
+  if (transfer_command_pool == nullptr) {
+    return;
+  }
+
+  vk::raii::CommandBuffers transfer_command_buffers{
+    device,
+    vk::CommandBufferAllocateInfo{
+      .commandPool = transfer_command_pool,
+      .level = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = config.frames_in_flight,
+    },
   };
 
-  spdlog::info("Creating pipeline layout");
-  pipeline_layout = vk::raii::PipelineLayout(device, layout_info);
+  for (usize i = 0; i < frames.size(); i++) {
+    frames[i].transfer_command_buffer = std::move(transfer_command_buffers[i]);
+  }
+}
 
-  vk::PipelineRenderingCreateInfo pipeling_rendering_create_info{
-    .colorAttachmentCount = 1,
-    .pColorAttachmentFormats = &swap_chain_image_format
+auto App::create_sync_objects() -> void {
+  const vk::SemaphoreTypeCreateInfo timeline_type_info{
+    .semaphoreType = vk::SemaphoreType::eTimeline,
+    .initialValue = 0,
   };
 
-  vk::GraphicsPipelineCreateInfo pipeline_info{
-    .pNext = &pipeling_rendering_create_info,
-    .stageCount = 2,
-    .pStages = &stages[0],
-    .pVertexInputState = &vertex_input_info,
-    .pInputAssemblyState = &input_assembly,
-    .pViewportState = &viewport_state,
-    .pRasterizationState = &rasterizer,
-    .pMultisampleState = &multisampling,
-    .pColorBlendState = &color_blend_state,
-    .pDynamicState = &dynamic_state,
-    .layout = pipeline_layout,
-    .renderPass = nullptr,
-    .basePipelineHandle = VK_NULL_HANDLE
+  frame_timeline = vk::raii::Semaphore{
+    device,
+    vk::SemaphoreCreateInfo{.pNext = &timeline_type_info},
   };
 
-  spdlog::info("Creating graphics pipeline");
+  transfer_timeline = vk::raii::Semaphore{
+    device,
+    vk::SemaphoreCreateInfo{.pNext = &timeline_type_info},
+  };
 
-  graphics_pipeline = vk::raii::Pipeline{
+  compute_timeline = vk::raii::Semaphore{
     device,
-    nullptr,
-    pipeline_info,
+    vk::SemaphoreCreateInfo{.pNext = &timeline_type_info},
   };
 
-  // colorBlendAttachment.blendEnable = vk::True;
-  // colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
-  // colorBlendAttachment.dstColorBlendFactor =
-  // vk::BlendFactor::eOneMinusSrcAlpha; colorBlendAttachment.colorBlendOp =
-  // vk::BlendOp::eAdd; colorBlendAttachment.srcAlphaBlendFactor =
-  // vk::BlendFactor::eOne; colorBlendAttachment.dstAlphaBlendFactor =
-  // vk::BlendFactor::eZero; colorBlendAttachment.alphaBlendOp =
-  // vk::BlendOp::eAdd;
+  if (config.headless) {
+    return;
+  }
+
+  for (Output& output: outputs) {
+    output.image_available.clear();
+
+    for (usize i = 0; i < frames.size(); i++) {
+      output.image_available.emplace_back(device, vk::SemaphoreCreateInfo{});
+    }
+
+    create_present_semaphores(output);
+  }
 }
 
-auto App::create_shader_module(Span<const u8> code) const
-  -> vk::raii::ShaderModule {
-  spdlog::info("{}", code.size());
-  vk::ShaderModuleCreateInfo info{
-    .codeSize = code.size_bytes(),
-    .pCode = reinterpret_cast<const uint32_t*>(code.data()) // NOLINT
-  };
+auto App::create_present_semaphores(Output& output) -> void {
+  output.render_finished.clear();
+
+  if (config.headless) {
+    return;
+  }
 
-  vk::raii::ShaderModule module{device, info};
-  return module;
+  for (usize i = 0; i < output.images.size(); i++) {
+    output.render_finished.emplace_back(device, vk::SemaphoreCreateInfo{});
+  }
 }
 
-auto App::create_command_pool() -> void {
-  vk::CommandPoolCreateInfo pool_info{
-    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-    .queueFamilyIndex = graphics_index,
+auto App::wait_for_timeline(const u64 value) const -> void {
+  if (value == 0) {
+    return;
+  }
+
+  const vk::SemaphoreWaitInfo wait_info{
+    .semaphoreCount = 1,
+    .pSemaphores = &*frame_timeline,
+    .pValues = &value,
   };
 
-  command_pool = vk::raii::CommandPool{device, pool_info};
+  [[maybe_unused]] const vk::Result result{
+    device.waitSemaphores(wait_info, std::numeric_limits<u64>::max())
+  };
 }
-
-auto App::create_command_buffer() -> void {}
@@ -6,8 +6,107 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include "BindlessHeap.hpp"
+#include "CullPass.hpp"
+#include "DebugLog.hpp"
+#include "DeletionQueue.hpp"
+#include "FrameArena.hpp"
+#include "FrameCapture.hpp"
+#include "FramePacer.hpp"
+#include "GpuAllocator.hpp"
+#include "JobSystem.hpp"
+#include "LatencyProfile.hpp"
+#include "Mesh.hpp"
+#include "ParallelRecorder.hpp"
+#include "ParticleSystem.hpp"
+#include "Queues.hpp"
+#include "RenderGraph.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineVariants.hpp"
+#include "Profiler.hpp"
+#include "ShaderObjects.hpp"
+#include "ShaderWatcher.hpp"
+#include "StagingRing.hpp"
+#include "TaskGraph.hpp"
+#include "UniformRing.hpp"
+
+struct AppConfig {
+  // render into device-owned offscreen images instead of a GLFW window /
+  // swapchain, for GPU-less machines running a software ICD (eg. lavapipe)
+  bool headless{false};
+
+  // substring of the physical device name to prefer (eg. "llvmpipe"), empty
+  // picks the first suitable device
+  String preferred_device{};
+
+  // fail instead of falling back when no device matches preferred_device
+  bool require_preferred_device{false};
+
+  // present mode, swapchain depth and frame pacing, see LatencyProfile
+  LatencyProfile latency_profile{LatencyProfile::eMaxThroughput};
+
+  // how many frames the CPU may record ahead of the GPU, 0 takes the latency
+  // profile's
+  u32 frames_in_flight{0};
+
+  // stop after this many frames, 0 runs until a window is closed
+  u64 frame_limit{0};
+
+  // where compiled pipelines are persisted between runs
+  std::filesystem::path pipeline_cache_path{"pipeline_cache.bin"};
+
+  // dev mode, recompile shaders/*.slang on change and swap the pipeline in
+  bool hot_reload{false};
+
+  // objects in the scene, each one is its own draw call
+  u32 object_count{1};
+
+  // job system workers, 0 sizes it to the machine
+  u32 worker_threads{0};
+
+  // cull and generate draws in a compute pass instead of recording one draw
+  // per object on the CPU
+  bool gpu_driven{false};
+
+  // how the triangle is shaded, see ColorMode in triangle.slang, C cycles
+  // through them at run time
+  u32 color_mode{0};
+
+  // directory rendered frames are streamed to, empty disables capture
+  std::filesystem::path capture_path{};
+  CaptureFormat capture_format{CaptureFormat::ePpm};
+
+  // draw through VK_EXT_shader_object shaders and dynamic state instead of
+  // pipelines, where the device supports it
+  bool shader_objects{false};
+
+  // particles simulated on the async compute queue and drawn over the
+  // scene, 0 disables them
+  u32 particle_count{0};
+
+  // windows opened on the one device, every frame draws all of them in a
+  // single submission and presents them with a single call. Headless runs
+  // always have one target
+  u32 window_count{1};
+
+  // fraction of each output's size the scene is drawn at, into a transient
+  // image that is then blitted over the output. 1 draws straight into it
+  f32 render_scale{1.0f};
+
+  // Chrome / Perfetto trace JSON written on exit, empty disables tracing
+  std::filesystem::path trace_path{};
+
+  // durations the profiler keeps per scope for its percentiles
+  usize profiler_history{Profiler::HISTORY_SIZE};
+};
 
-[[nodiscard]] auto read_file_contents(StringView path) -> Vec<u8>;
+// wall time of one init_vulkan stage
+struct InitStageTiming {
+  StringView name;
+  f64 ms;
+};
 
 class App {
 public:
@@ -15,6 +114,23 @@ public:
   static constexpr usize WIDTH = 800;
   static constexpr usize HEIGHT = 800;
 
+  static constexpr u32 HEADLESS_IMAGE_COUNT = 3;
+  static constexpr u32 MAX_FRAMES_IN_FLIGHT = 8;
+  static constexpr u64 DEFAULT_HEADLESS_FRAME_LIMIT = 1000;
+
+  static constexpr f32 MIN_RENDER_SCALE = 0.25f;
+  static constexpr f32 MAX_RENDER_SCALE = 2.0f;
+
+  // below this many draws per slice, threading costs more than it saves
+  static constexpr u32 MIN_OBJECTS_PER_SLICE = 256;
+
+  // set by CMake, the shader sources and how add_slang_shader compiles them,
+  // for hot reload
+  static constexpr StringView SHADER_DIR{LEARN_VULKAN_SHADER_DIR};
+  static constexpr StringView SLANGC_EXECUTABLE{LEARN_VULKAN_SLANGC};
+  static constexpr StringView SLANGC_FLAGS{LEARN_VULKAN_SLANGC_FLAGS};
+  static constexpr vk::Format HEADLESS_IMAGE_FORMAT = vk::Format::eB8G8R8A8Srgb;
+
   inline static constexpr std::array VALIDATION_LAYERS{
     "VK_LAYER_KHRONOS_validation"
   };
@@ -30,6 +146,18 @@ public:
 #endif
   };
 
+  // enabled when the device has all of them, pipeline variants are then
+  // fast linked from libraries
+  inline static constexpr std::array PIPELINE_LIBRARY_EXTENSIONS{
+    vk::KHRPipelineLibraryExtensionName,
+    vk::EXTGraphicsPipelineLibraryExtensionName,
+  };
+
+  // enabled with AppConfig::shader_objects when the device has it
+  inline static constexpr std::array SHADER_OBJECT_EXTENSIONS{
+    vk::EXTShaderObjectExtensionName,
+  };
+
 #ifdef NDEBUG
   static constexpr bool ENABLE_VALIDATION_LAYERS{false};
 #else
@@ -43,86 +171,378 @@ public:
     .apiVersion = vk::ApiVersion14,
   };
 
+  explicit App(AppConfig config = {});
+
   auto run() -> void;
 
+  // the rest are for inspecting a finished run()
+
+  [[nodiscard]] auto get_profiler() const -> const Profiler& {
+    return profiler;
+  }
+
+  [[nodiscard]] auto get_init_stages() const -> Span<const InitStageTiming> {
+    return init_stages;
+  }
+
+  [[nodiscard]] auto get_device_name() const -> const String& {
+    return device_name;
+  }
+
+  [[nodiscard]] auto get_frame_count() const -> u64 { return frame_number; }
+
 private:
 
+  struct FrameData {
+    vk::raii::CommandBuffer command_buffer{nullptr};
+
+    // from transfer_command_pool, only with a dedicated transfer queue
+    vk::raii::CommandBuffer transfer_command_buffer{nullptr};
+
+    // from compute_command_pool, only with particles
+    vk::raii::CommandBuffer compute_command_buffer{nullptr};
+
+    // frame_timeline value signalled by this frame's last submission
+    u64 timeline_value{0};
+
+    // CPU scratch for the frame's containers, reset once timeline_value has
+    // retired
+    FrameArena arena{};
+  };
+
+  // one window and everything that presents to it, or the offscreen images
+  // standing in for them when headless
+  struct Output {
+    // for the GLFW callbacks, which only get the window
+    App* app{nullptr};
+
+    // names the output's image in the render graph
+    String name{};
+
+    GLFWwindow* window{nullptr};
+    vk::raii::SurfaceKHR surface{nullptr};
+
+    vk::raii::SwapchainKHR swap_chain{nullptr};
+    Vec<vk::Image> images{};
+    Vec<vk::raii::ImageView> image_views{};
+
+    // backing storage for images when running headless
+    Vec<GpuImage> offscreen_images{};
+
+    // binary, one per frame in flight, signalled by the swapchain once the
+    // acquired image is usable
+    Vec<vk::raii::Semaphore> image_available{};
+
+    // binary, one per swapchain image as presentation may hold on to them
+    // past the frame that signalled them
+    Vec<vk::raii::Semaphore> render_finished{};
+
+    vk::PresentModeKHR present_mode{};
+    vk::Extent2D extent{};
+
+    // set on resize or an out of date / suboptimal swapchain, recreated at
+    // the start of the next frame
+    bool dirty{false};
+
+    // what this frame draws into, none while the output sits a frame out
+    Option<u32> image_index{};
+  };
+
   auto init_vulkan() -> void;
 
+  auto create_job_system() -> void;
+
+  auto create_profiler() -> void;
+
   auto create_instance() -> void;
 
+  // main thread only
+  auto init_glfw() -> void;
+
+  // main thread only
+  auto create_windows() -> void;
+
+  auto create_surfaces() -> void;
+
   auto setup_debug_messenger() -> void;
 
   auto update() -> void;
 
+  [[nodiscard]] auto should_close() const -> bool;
+
+  auto draw_frame() -> void;
+
+  // the image output draws into this frame, none if it has to sit the
+  // frame out (minimized or out of date)
+  [[nodiscard]] auto acquire_image(Output& output, u32 frame_index)
+    -> Option<u32>;
+
+  // uploads, records and submits the frame, everything after input sampling
+  auto submit_frame(FrameData& frame, u64 value) -> void;
+
+  // presents every output that was drawn this frame in one call
+  auto present_outputs(FrameData& frame) -> void;
+
+  auto record_command_buffer(vk::raii::CommandBuffer& cmd) -> void;
+
+  // everything between begin and end of the frame's command buffer, built
+  // as a render graph
+  auto record_frame(const vk::raii::CommandBuffer& cmd) -> void;
+
+  // the scene into target, which is already a colour attachment
+  auto record_draw_pass(
+    const vk::raii::CommandBuffer& cmd,
+    vk::ImageView target,
+    vk::Extent2D extent
+  ) -> void;
+
+  // stretches source, in eTransferSrcOptimal, over all of target, in
+  // eTransferDstOptimal
+  auto record_upscale(
+    const vk::raii::CommandBuffer& cmd,
+    vk::Image source,
+    vk::Extent2D source_extent,
+    vk::Image target,
+    vk::Extent2D target_extent
+  ) const -> void;
+
+  // binds everything the scene's draws need and draws objects
+  // [first_object, first_object + object_count)
+  auto record_draws(
+    const vk::raii::CommandBuffer& cmd,
+    vk::Extent2D extent,
+    u32 first_object,
+    u32 object_count
+  ) const -> void;
+
+  auto bind_draw_state(
+    const vk::raii::CommandBuffer& cmd,
+    vk::Extent2D extent
+  ) const -> void;
+
+  // the particles over the scene, after bind_draw_state
+  auto record_particles(const vk::raii::CommandBuffer& cmd) const -> void;
+
   auto cleanup() -> void;
 
   auto pick_physical_device() -> void;
 
   auto create_logical_device() -> void;
 
-  auto create_swap_chain() -> void;
+  auto create_pipeline_cache() -> void;
+
+  auto create_bindless_heap() -> void;
+
+  auto create_allocator() -> void;
+
+  auto create_staging_ring() -> void;
+
+  auto create_uniform_ring() -> void;
+
+  auto create_vertex_buffers() -> void;
 
-  auto create_image_view() -> void;
+  auto create_instance_buffer() -> void;
+
+  auto create_cull_pass() -> void;
+
+  // only with AppConfig::particle_count
+  auto create_particle_system() -> void;
+
+  // only with AppConfig::capture_path
+  auto create_frame_capture() -> void;
+
+  // everything pipelines need to know about the swapchain
+  auto choose_swap_chain_format() -> void;
+
+  auto create_swap_chains() -> void;
+
+  auto create_swap_chain(Output& output) -> void;
+
+  // hands the old swapchain over through oldSwapchain and retires it, its
+  // views and present semaphores without waiting on the device, returns
+  // false while the window is minimized
+  [[nodiscard]] auto recreate_swap_chain(Output& output) -> bool;
+
+  auto create_offscreen_images(Output& output) -> void;
+
+  auto create_image_views() -> void;
+
+  auto create_image_views(Output& output) -> void;
 
   auto create_graphics_pipeline() -> void;
 
+  auto start_shader_watcher() -> void;
+
+  // swaps in hot reloaded shaders, only called between frames
+  auto apply_pending_pipeline() -> void;
+
   auto create_command_pool() -> void;
 
   auto create_command_buffer() -> void;
 
-  [[nodiscard]] auto create_shader_module(Span<const u8> code) const
-    -> vk::raii::ShaderModule;
+  auto create_sync_objects() -> void;
 
-  static auto is_device_suitable(const vk::raii::PhysicalDevice& device)
-    -> bool;
+  // render_finished, sized to the output's swapchain
+  auto create_present_semaphores(Output& output) -> void;
 
-  static auto find_graphics_queue_family(const vk::raii::PhysicalDevice& device)
-    -> Option<u32>;
+  auto wait_for_timeline(u64 value) const -> void;
+
+  // copies pending first uploads on the dedicated transfer queue, returns
+  // true if the frame has to wait on transfer_timeline
+  [[nodiscard]] auto submit_async_uploads(FrameData& frame, u64 value) -> bool;
+
+  // steps the particles on compute_queue, returns true if the frame has to
+  // wait on compute_timeline
+  [[nodiscard]] auto submit_async_compute(FrameData& frame, u64 value) -> bool;
+
+  [[nodiscard]] auto is_device_suitable(
+    const vk::raii::PhysicalDevice& device
+  ) const -> bool;
+
+  [[nodiscard]] auto get_required_extensions() const -> Vec<const char*>;
+
+  [[nodiscard]] auto get_device_extensions() const -> Vec<const char*>;
 
-  [[nodiscard]] static auto get_required_extensions() -> Vec<const char*>;
+  [[nodiscard]] static auto supports_extensions(
+    const vk::raii::PhysicalDevice& device,
+    Span<const char* const> extensions
+  ) -> bool;
 
-  static vk::Bool32 debug_callback(
-    vk::DebugUtilsMessageSeverityFlagBitsEXT severity,
-    vk::DebugUtilsMessageTypeFlagsEXT type,
-    const vk::DebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* //
-  );
+  [[nodiscard]] static auto supports_pipeline_library(
+    const vk::raii::PhysicalDevice& device
+  ) -> bool;
+
+  [[nodiscard]] static auto supports_shader_object(
+    const vk::raii::PhysicalDevice& device
+  ) -> bool;
 
   [[nodiscard]] static auto choose_swap_surface_format(
     const std::vector<vk::SurfaceFormatKHR>& available_formats
   ) -> vk::SurfaceFormatKHR;
 
+  // the first of preferred_modes the surface supports, FIFO otherwise
   [[nodiscard]] static auto choose_swap_surface_present_mode(
-    const Vec<vk::PresentModeKHR>& available_modes
+    const Vec<vk::PresentModeKHR>& available_modes,
+    Span<const vk::PresentModeKHR> preferred_modes
   ) -> vk::PresentModeKHR;
 
-  [[nodiscard]] auto choose_swap_extent(
-    const vk::SurfaceCapabilitiesKHR& capabilities
+  [[nodiscard]] static auto choose_swap_extent(
+    const vk::SurfaceCapabilitiesKHR& capabilities,
+    GLFWwindow* window
   ) -> vk::Extent2D;
 
 private:
 
-  GLFWwindow* window{nullptr};
+  AppConfig config;
+  LatencySettings latency;
+  FramePacer pacer{};
+
+  Profiler profiler{};
+  Vec<InitStageTiming> init_stages{};
+  String device_name{};
+
   vk::raii::Context context{};
+
+  // outlives the instance, the messenger points at it
+  DebugLog debug_log{};
+
   vk::raii::Instance instance{nullptr};
+
+  // only with validation layers
+  vk::raii::DebugUtilsMessengerEXT debug_messenger{nullptr};
+
   vk::raii::PhysicalDevice physical_device{nullptr};
   vk::raii::Device device{nullptr};
+  QueueFamilies queue_families{};
   vk::raii::Queue graphics_queue{nullptr};
-  vk::raii::SurfaceKHR surface{nullptr};
 
-  vk::raii::SwapchainKHR swap_chain{nullptr};
-  Vec<vk::Image> swap_chain_images{};
-  Vec<vk::raii::ImageView> swap_chain_image_views{};
+  // alias graphics_queue when the device has no dedicated family for them
+  vk::raii::Queue compute_queue{nullptr};
+  vk::raii::Queue transfer_queue{nullptr};
+
+  GpuAllocator allocator{};
+  StagingRing staging_ring{};
+  UniformRing uniform_ring{};
+
+  // sized once by the constructor and never again, the GLFW callbacks point
+  // into it
+  Vec<Output> outputs{};
+
+  PipelineCache pipeline_cache{};
+
+  // every pipeline is built on its layout
+  BindlessHeap bindless{};
+
+  // VK_EXT_graphics_pipeline_library is enabled
+  bool pipeline_library{false};
 
-  vk::raii::Pipeline graphics_pipeline{nullptr};
-  vk::raii::PipelineLayout pipeline_layout{nullptr};
+  PipelineVariants pipelines{};
+
+  // what this frame's draws use, resolved once before recording
+  PipelineVariants::Key variant_key{};
+  vk::Pipeline current_pipeline{};
+
+  // where this frame's DrawConstants sit in uniform_ring
+  u32 draw_constants_offset{0};
+
+  // VK_EXT_shader_object is enabled and draws use shader_objects, pipelines
+  // are never built
+  bool shader_object{false};
+  std::shared_ptr<ShaderObjects> shader_objects{};
+
+  // built by shader_watcher's thread, picked up at the next frame boundary
+  std::mutex pending_pipeline_mutex{};
+  std::shared_ptr<PipelineVariants::Shaders> pending_shaders{};
+  std::shared_ptr<ShaderObjects> pending_shader_objects{};
+  std::unique_ptr<ShaderWatcher> shader_watcher{};
+
+  // resources retired while frames that use them may still be in flight
+  DeletionQueue deletion_queue{};
   vk::raii::CommandPool command_pool{nullptr};
+  vk::raii::CommandPool transfer_command_pool{nullptr};
+  vk::raii::CommandPool compute_command_pool{nullptr};
+
+  Mesh mesh{};
 
+  GpuBuffer instance_buffer{};
+  u32 instance_count{0};
+
+  // only with AppConfig::gpu_driven
+  CullPass cull_pass{};
+
+  // only with AppConfig::particle_count
+  ParticleSystem particles{};
+
+  FrameCapture capture{};
+
+  std::unique_ptr<JobSystem> jobs{};
+  ParallelRecorder recorder{};
+
+  // rebuilt every frame by record_frame
+  RenderGraph render_graph{};
+
+  Vec<FrameData> frames{};
+
+  // single timeline that every frame submission signals, value == frame_number
+  vk::raii::Semaphore frame_timeline{nullptr};
+  u64 frame_number{0};
+
+  // signalled with the frame's value by async uploads on transfer_queue
+  vk::raii::Semaphore transfer_timeline{nullptr};
+
+  // signalled with the frame's value by the particle step on compute_queue
+  vk::raii::Semaphore compute_timeline{nullptr};
+
+  // acquire halves of ownership transfers from transfer_queue, recorded at
+  // the start of the next graphics command buffer
+  Vec<vk::BufferMemoryBarrier2> pending_acquires{};
+
+  // shared by every output, so one set of pipelines draws into all of them
   vk::SurfaceFormatKHR swap_chain_surface_format{};
-  vk::PresentModeKHR swap_chain_surface_present_mode{};
   vk::Format swap_chain_image_format{vk::Format::eUndefined};
-  vk::Extent2D swap_chain_extent{};
+
+  // how a scaled scene is stretched over its output, see render_scale
+  vk::Filter scale_filter{vk::Filter::eLinear};
 
   u32 graphics_index{0};
 };
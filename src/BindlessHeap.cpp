@@ -0,0 +1,296 @@
+#include "BindlessHeap.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+auto BindlessHeap::init(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physical_device,
+  const Span<const vk::DescriptorSetLayout> extra_set_layouts
+) -> void {
+  this->device = &device;
+
+  const auto properties = physical_device.getProperties2<
+    vk::PhysicalDeviceProperties2,
+    vk::PhysicalDeviceVulkan12Properties>();
+
+  const vk::PhysicalDeviceVulkan12Properties& limits{
+    properties.get<vk::PhysicalDeviceVulkan12Properties>()
+  };
+
+  // every binding is visible to every stage, so the per stage limits apply
+  // as well as the per set ones, and all three share the per stage total
+  const u32 share{limits.maxPerStageUpdateAfterBindResources / 3};
+
+  const u32 storage_buffer_count{std::min({
+    MAX_STORAGE_BUFFERS,
+    limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+    limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+    share,
+  })};
+
+  const u32 sampled_image_count{std::min({
+    MAX_SAMPLED_IMAGES,
+    limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+    limits.maxDescriptorSetUpdateAfterBindSampledImages,
+    share,
+  })};
+
+  const u32 sampler_count{std::min({
+    MAX_SAMPLERS,
+    limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+    limits.maxDescriptorSetUpdateAfterBindSamplers,
+    share,
+  })};
+
+  spdlog::info(
+    "Creating bindless heap: {} storage buffers, {} sampled images, {} "
+    "samplers",
+    storage_buffer_count,
+    sampled_image_count,
+    sampler_count
+  );
+
+  const std::array bindings{
+    vk::DescriptorSetLayoutBinding{
+      .binding = STORAGE_BUFFER_BINDING,
+      .descriptorType = vk::DescriptorType::eStorageBuffer,
+      .descriptorCount = storage_buffer_count,
+      .stageFlags = STAGES,
+    },
+    vk::DescriptorSetLayoutBinding{
+      .binding = SAMPLED_IMAGE_BINDING,
+      .descriptorType = vk::DescriptorType::eSampledImage,
+      .descriptorCount = sampled_image_count,
+      .stageFlags = STAGES,
+    },
+    vk::DescriptorSetLayoutBinding{
+      .binding = SAMPLER_BINDING,
+      .descriptorType = vk::DescriptorType::eSampler,
+      .descriptorCount = sampler_count,
+      .stageFlags = STAGES,
+    },
+  };
+
+  // slots that were never written or were released are fine as long as no
+  // shader invocation reads them
+  constexpr vk::DescriptorBindingFlags BINDING_FLAGS{
+    vk::DescriptorBindingFlagBits::eUpdateAfterBind
+    | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending
+    | vk::DescriptorBindingFlagBits::ePartiallyBound
+  };
+
+  const std::array<vk::DescriptorBindingFlags, bindings.size()> binding_flags{
+    BINDING_FLAGS,
+    BINDING_FLAGS,
+    BINDING_FLAGS,
+  };
+
+  const vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{
+    .bindingCount = static_cast<u32>(binding_flags.size()),
+    .pBindingFlags = binding_flags.data(),
+  };
+
+  set_layout = vk::raii::DescriptorSetLayout{
+    device,
+    vk::DescriptorSetLayoutCreateInfo{
+      .pNext = &binding_flags_info,
+      .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+      .bindingCount = static_cast<u32>(bindings.size()),
+      .pBindings = bindings.data(),
+    },
+  };
+
+  const std::array pool_sizes{
+    vk::DescriptorPoolSize{
+      .type = vk::DescriptorType::eStorageBuffer,
+      .descriptorCount = storage_buffer_count,
+    },
+    vk::DescriptorPoolSize{
+      .type = vk::DescriptorType::eSampledImage,
+      .descriptorCount = sampled_image_count,
+    },
+    vk::DescriptorPoolSize{
+      .type = vk::DescriptorType::eSampler,
+      .descriptorCount = sampler_count,
+    },
+  };
+
+  // the raii set frees itself, which the pool has to allow
+  descriptor_pool = vk::raii::DescriptorPool{
+    device,
+    vk::DescriptorPoolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind
+             | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = 1,
+      .poolSizeCount = static_cast<u32>(pool_sizes.size()),
+      .pPoolSizes = pool_sizes.data(),
+    },
+  };
+
+  vk::raii::DescriptorSets sets{
+    device,
+    vk::DescriptorSetAllocateInfo{
+      .descriptorPool = descriptor_pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &*set_layout,
+    },
+  };
+  descriptor_set = std::move(sets.front());
+
+  const vk::PushConstantRange push_constant_range{
+    .stageFlags = STAGES,
+    .offset = 0,
+    .size = PUSH_CONSTANT_SIZE,
+  };
+
+  set_layouts = {*set_layout};
+  set_layouts.insert(
+    set_layouts.end(),
+    extra_set_layouts.begin(),
+    extra_set_layouts.end()
+  );
+
+  pipeline_layout = vk::raii::PipelineLayout{
+    device,
+    vk::PipelineLayoutCreateInfo{
+      .setLayoutCount = static_cast<u32>(set_layouts.size()),
+      .pSetLayouts = set_layouts.data(),
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &push_constant_range,
+    },
+  };
+
+  storage_buffers = SlotAllocator{storage_buffer_count};
+  sampled_images = SlotAllocator{sampled_image_count};
+  samplers = SlotAllocator{sampler_count};
+}
+
+auto BindlessHeap::clear() -> void {
+  pipeline_layout.clear();
+  set_layouts.clear();
+  descriptor_set.clear();
+  descriptor_pool.clear();
+  set_layout.clear();
+
+  storage_buffers = {};
+  sampled_images = {};
+  samplers = {};
+  device = nullptr;
+}
+
+auto BindlessHeap::add_storage_buffer(
+  const vk::Buffer buffer,
+  const vk::DeviceSize offset,
+  const vk::DeviceSize range
+) -> u32 {
+  const u32 slot{allocate(Kind::eStorageBuffer)};
+
+  const vk::DescriptorBufferInfo buffer_info{
+    .buffer = buffer,
+    .offset = offset,
+    .range = range,
+  };
+
+  device->updateDescriptorSets(
+    vk::WriteDescriptorSet{
+      .dstSet = descriptor_set,
+      .dstBinding = STORAGE_BUFFER_BINDING,
+      .dstArrayElement = slot,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eStorageBuffer,
+      .pBufferInfo = &buffer_info,
+    },
+    {}
+  );
+
+  return slot;
+}
+
+auto BindlessHeap::add_sampled_image(
+  const vk::ImageView view,
+  const vk::ImageLayout layout
+) -> u32 {
+  const u32 slot{allocate(Kind::eSampledImage)};
+
+  const vk::DescriptorImageInfo image_info{
+    .imageView = view,
+    .imageLayout = layout,
+  };
+
+  device->updateDescriptorSets(
+    vk::WriteDescriptorSet{
+      .dstSet = descriptor_set,
+      .dstBinding = SAMPLED_IMAGE_BINDING,
+      .dstArrayElement = slot,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eSampledImage,
+      .pImageInfo = &image_info,
+    },
+    {}
+  );
+
+  return slot;
+}
+
+auto BindlessHeap::add_sampler(const vk::Sampler sampler) -> u32 {
+  const u32 slot{allocate(Kind::eSampler)};
+
+  const vk::DescriptorImageInfo image_info{.sampler = sampler};
+
+  device->updateDescriptorSets(
+    vk::WriteDescriptorSet{
+      .dstSet = descriptor_set,
+      .dstBinding = SAMPLER_BINDING,
+      .dstArrayElement = slot,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eSampler,
+      .pImageInfo = &image_info,
+    },
+    {}
+  );
+
+  return slot;
+}
+
+auto BindlessHeap::release(const Kind kind, const u32 slot, const u64 value)
+  -> void {
+  get_slots(kind).release(slot, value);
+}
+
+auto BindlessHeap::collect(const u64 completed_value) -> void {
+  storage_buffers.collect(completed_value);
+  sampled_images.collect(completed_value);
+  samplers.collect(completed_value);
+}
+
+auto BindlessHeap::bind(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::PipelineBindPoint point
+) const -> void {
+  cmd.bindDescriptorSets(point, pipeline_layout, 0, {*descriptor_set}, {});
+}
+
+auto BindlessHeap::allocate(const Kind kind) -> u32 {
+  const Option<u32> slot{get_slots(kind).allocate()};
+
+  if (slot.is_none()) {
+    throw std::runtime_error{fmt::format(
+      "Bindless heap is out of {} slots",
+      kind == Kind::eStorageBuffer  ? "storage buffer"
+      : kind == Kind::eSampledImage ? "sampled image"
+                                    : "sampler"
+    )};
+  }
+
+  return slot.get_unchecked();
+}
+
+auto BindlessHeap::get_slots(const Kind kind) -> SlotAllocator& {
+  switch (kind) {
+    case Kind::eStorageBuffer: return storage_buffers;
+    case Kind::eSampledImage: return sampled_images;
+    case Kind::eSampler: return samplers;
+  }
+
+  return storage_buffers;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "SlotAllocator.hpp"
+
+// One global descriptor set holding every storage buffer, sampled image and
+// sampler, each kind a large partially bound array in its own binding.
+// Resources are registered once and referred to by their slot index, which
+// shaders get through push constants (see shaders/bindless.slang).
+//
+// Every pipeline shares the heap's pipeline layout, so the set is bound once
+// per command buffer rather than per draw, and descriptors can be written
+// while it is bound in command buffers that are still pending, as long as
+// those do not use the slot being written.
+//
+// Not thread safe, registration happens on one thread at a time.
+class BindlessHeap {
+public:
+
+  static constexpr u32 STORAGE_BUFFER_BINDING = 0;
+  static constexpr u32 SAMPLED_IMAGE_BINDING = 1;
+  static constexpr u32 SAMPLER_BINDING = 2;
+
+  // upper bounds, init() lowers them to what the device supports
+  static constexpr u32 MAX_STORAGE_BUFFERS = 1 << 16;
+  static constexpr u32 MAX_SAMPLED_IMAGES = 1 << 16;
+  static constexpr u32 MAX_SAMPLERS = 1 << 10;
+
+  // the minimum maxPushConstantsSize every implementation supports
+  static constexpr u32 PUSH_CONSTANT_SIZE = 128;
+
+  // the set and push constants are visible to every stage, so one layout
+  // fits graphics and compute alike
+  static constexpr vk::ShaderStageFlags STAGES = vk::ShaderStageFlagBits::eAll;
+
+  enum class Kind {
+    eStorageBuffer,
+    eSampledImage,
+    eSampler,
+  };
+
+  // extra_set_layouts become sets 1, 2, ... of the shared pipeline layout,
+  // for the few resources that are not indexed through the heap
+  auto init(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    Span<const vk::DescriptorSetLayout> extra_set_layouts = {}
+  ) -> void;
+
+  auto clear() -> void;
+
+  // the returned slot is the index into the matching array in shaders
+
+  [[nodiscard]] auto add_storage_buffer(
+    vk::Buffer buffer,
+    vk::DeviceSize offset = 0,
+    vk::DeviceSize range = vk::WholeSize
+  ) -> u32;
+
+  [[nodiscard]] auto add_sampled_image(
+    vk::ImageView view,
+    vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal
+  ) -> u32;
+
+  [[nodiscard]] auto add_sampler(vk::Sampler sampler) -> u32;
+
+  // the slot is reused once collect() is called with a value >= value, the
+  // descriptor itself is left as is until then
+  auto release(Kind kind, u32 slot, u64 value) -> void;
+
+  auto collect(u64 completed_value) -> void;
+
+  auto bind(const vk::raii::CommandBuffer& cmd, vk::PipelineBindPoint point)
+    const -> void;
+
+  template<typename T>
+  auto push_constants(const vk::raii::CommandBuffer& cmd, const T& constants)
+    const -> void {
+    static_assert(sizeof(T) <= PUSH_CONSTANT_SIZE);
+    cmd.pushConstants<T>(pipeline_layout, STAGES, 0, constants);
+  }
+
+  // every set of the pipeline layout in order, the heap's first
+  [[nodiscard]] auto get_set_layouts() const
+    -> Span<const vk::DescriptorSetLayout> {
+    return set_layouts;
+  }
+
+  [[nodiscard]] auto get_pipeline_layout() const
+    -> const vk::raii::PipelineLayout& {
+    return pipeline_layout;
+  }
+
+private:
+
+  [[nodiscard]] auto allocate(Kind kind) -> u32;
+
+  [[nodiscard]] auto get_slots(Kind kind) -> SlotAllocator&;
+
+  const vk::raii::Device* device{nullptr};
+
+  vk::raii::DescriptorSetLayout set_layout{nullptr};
+  vk::raii::DescriptorPool descriptor_pool{nullptr};
+  vk::raii::DescriptorSet descriptor_set{nullptr};
+  vk::raii::PipelineLayout pipeline_layout{nullptr};
+  Vec<vk::DescriptorSetLayout> set_layouts{};
+
+  SlotAllocator storage_buffers{};
+  SlotAllocator sampled_images{};
+  SlotAllocator samplers{};
+};
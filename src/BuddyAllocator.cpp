@@ -0,0 +1,97 @@
+#include "BuddyAllocator.hpp"
+#include <bit>
+#include <cassert>
+
+BuddyAllocator::BuddyAllocator(const u64 size, const u64 min_block_size):
+    size{next_power_of_two(size)},
+    min_block_size{next_power_of_two(min_block_size)},
+    max_order{static_cast<u32>(
+      std::countr_zero(this->size) - std::countr_zero(this->min_block_size)
+    )},
+    free_bytes{this->size},
+    free_lists(max_order + 1) {
+  free_lists.at(max_order).insert(0);
+}
+
+auto BuddyAllocator::allocate(const u64 size, const u64 alignment)
+  -> Option<u64> {
+  const u64 wanted{
+    next_power_of_two(std::max({size, alignment, min_block_size}))
+  };
+
+  if (wanted > this->size) {
+    return crab::none;
+  }
+
+  const u32 order{static_cast<u32>(
+    std::countr_zero(wanted) - std::countr_zero(min_block_size)
+  )};
+
+  // smallest free block that fits
+  u32 found{order};
+  while (found <= max_order and free_lists.at(found).empty()) {
+    found++;
+  }
+
+  if (found > max_order) {
+    return crab::none;
+  }
+
+  const u64 offset{*free_lists.at(found).begin()};
+  free_lists.at(found).erase(free_lists.at(found).begin());
+
+  // split down to the requested order, keeping the low half each time
+  while (found > order) {
+    found--;
+    free_lists.at(found).insert(offset + order_size(found));
+  }
+
+  allocated.emplace(offset, order);
+  free_bytes -= order_size(order);
+
+  return offset;
+}
+
+auto BuddyAllocator::free(u64 offset) -> void {
+  const auto it = allocated.find(offset);
+  assert(it != allocated.end() && "freeing an offset that was not allocated");
+
+  u32 order{it->second};
+  allocated.erase(it);
+  free_bytes += order_size(order);
+
+  // merge with the buddy for as long as it is free too
+  while (order < max_order) {
+    const u64 buddy{offset ^ order_size(order)};
+    std::set<u64>& free_list{free_lists.at(order)};
+
+    const auto buddy_it = free_list.find(buddy);
+    if (buddy_it == free_list.end()) {
+      break;
+    }
+
+    free_list.erase(buddy_it);
+    offset = std::min(offset, buddy);
+    order++;
+  }
+
+  free_lists.at(order).insert(offset);
+}
+
+auto BuddyAllocator::block_size(const u64 offset) const -> u64 {
+  return order_size(allocated.at(offset));
+}
+
+auto BuddyAllocator::largest_free_block() const -> u64 {
+  for (u32 order = max_order + 1; order > 0; order--) {
+    if (not free_lists.at(order - 1).empty()) {
+      return order_size(order - 1);
+    }
+  }
+
+  return 0;
+}
+
+auto BuddyAllocator::next_power_of_two(const u64 value) -> u64 {
+  return value <= 1 ? 1 : std::bit_ceil(value);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <set>
+#include <unordered_map>
+
+// Power of two buddy allocator over an abstract range of offsets, it never
+// touches memory itself. Blocks are aligned to their own size, so any
+// alignment up to the block size is satisfied for free.
+class BuddyAllocator {
+public:
+
+  BuddyAllocator(u64 size, u64 min_block_size);
+
+  // returns the offset of a block of at least size bytes aligned to alignment
+  [[nodiscard]] auto allocate(u64 size, u64 alignment) -> Option<u64>;
+
+  auto free(u64 offset) -> void;
+
+  // size of the block backing the allocation at offset
+  [[nodiscard]] auto block_size(u64 offset) const -> u64;
+
+  [[nodiscard]] auto get_size() const -> u64 { return size; }
+
+  [[nodiscard]] auto get_free_bytes() const -> u64 { return free_bytes; }
+
+  [[nodiscard]] auto largest_free_block() const -> u64;
+
+  [[nodiscard]] auto is_empty() const -> bool { return free_bytes == size; }
+
+  [[nodiscard]] static auto next_power_of_two(u64 value) -> u64;
+
+private:
+
+  [[nodiscard]] auto order_size(u32 order) const -> u64 {
+    return min_block_size << order;
+  }
+
+  u64 size;
+  u64 min_block_size;
+  u32 max_order;
+  u64 free_bytes;
+
+  // free block offsets per order, ordered so splits hand out low offsets first
+  Vec<std::set<u64>> free_lists;
+
+  // order of every live allocation, keyed by offset
+  std::unordered_map<u64, u32> allocated{};
+};
+
+// Bump allocator over an abstract range, reset wholesale.
+class LinearAllocator {
+public:
+
+  explicit LinearAllocator(const u64 size): size{size} {}
+
+  [[nodiscard]] auto allocate(const u64 bytes, const u64 alignment)
+    -> Option<u64> {
+    const u64 offset = (head + alignment - 1) / alignment * alignment;
+
+    if (offset + bytes > size) {
+      return crab::none;
+    }
+
+    head = offset + bytes;
+    return offset;
+  }
+
+  auto reset() -> void { head = 0; }
+
+  [[nodiscard]] auto get_used() const -> u64 { return head; }
+
+  [[nodiscard]] auto get_size() const -> u64 { return size; }
+
+private:
+
+  u64 size;
+  u64 head{0};
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <fmt/format.h>
+#include <charconv>
+#include <stdexcept>
+
+namespace command_line {
+  // the whole value has to be a number, "abc" or "12abc" is an error naming
+  // the argument rather than a bare std::invalid_argument
+  template<typename T>
+  [[nodiscard]] auto parse_number(const StringView arg, const StringView value)
+    -> T {
+    T number{};
+    const char* end{value.data() + value.size()};
+    const auto [parsed_end, error] = std::from_chars(value.data(), end, number);
+
+    if (error != std::errc{} or parsed_end != end) {
+      throw std::runtime_error{
+        fmt::format("Invalid value '{}' for {}", value, arg)
+      };
+    }
+
+    return number;
+  }
+}
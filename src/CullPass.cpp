@@ -0,0 +1,113 @@
+#include "CullPass.hpp"
+#include <spdlog/spdlog.h>
+
+auto CullPass::init(
+  const vk::raii::Device& device,
+  GpuAllocator& allocator,
+  PipelineCache& pipeline_cache,
+  BindlessHeap& heap,
+  const Span<const u32> spirv,
+  const vk::Buffer instances,
+  const Constants& constants
+) -> void {
+  this->heap = &heap;
+
+  spdlog::info("Creating cull pass for {} instances", constants.instance_count);
+
+  const vk::raii::ShaderModule module{
+    device,
+    vk::ShaderModuleCreateInfo{
+      .codeSize = spirv.size_bytes(),
+      .pCode = spirv.data(),
+    },
+  };
+
+  pipeline = pipeline_cache.create_compute_pipeline({
+    .stage = {
+      .stage = vk::ShaderStageFlagBits::eCompute,
+      .module = module,
+      .pName = "cullMain",
+    },
+    .layout = heap.get_pipeline_layout(),
+  });
+
+  draw_buffer = allocator.create_buffer(
+    {
+      .size = std::max(constants.instance_count, 1u)
+            * sizeof(vk::DrawIndexedIndirectCommand),
+      .usage = vk::BufferUsageFlagBits::eStorageBuffer
+             | vk::BufferUsageFlagBits::eIndirectBuffer,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  count_buffer = allocator.create_buffer(
+    {
+      .size = sizeof(u32),
+      .usage = vk::BufferUsageFlagBits::eStorageBuffer
+             | vk::BufferUsageFlagBits::eIndirectBuffer
+             | vk::BufferUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+
+  push_constants = {
+    .constants = constants,
+    .instances = heap.add_storage_buffer(instances),
+    .draws = heap.add_storage_buffer(draw_buffer.get()),
+    .draw_count = heap.add_storage_buffer(count_buffer.get()),
+  };
+}
+
+auto CullPass::clear() -> void {
+  if (heap != nullptr) {
+    using enum BindlessHeap::Kind;
+    heap->release(eStorageBuffer, push_constants.instances, 0);
+    heap->release(eStorageBuffer, push_constants.draws, 0);
+    heap->release(eStorageBuffer, push_constants.draw_count, 0);
+    heap = nullptr;
+  }
+
+  count_buffer.reset();
+  draw_buffer.reset();
+  pipeline.clear();
+}
+
+auto CullPass::record_cull(const vk::raii::CommandBuffer& cmd) const -> void {
+  cmd.fillBuffer(count_buffer.get(), 0, sizeof(u32), 0);
+
+  const vk::MemoryBarrier2 cleared{
+    .srcStageMask = vk::PipelineStageFlagBits2::eClear,
+    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+    .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead
+                   | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+
+  cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &cleared}
+  );
+
+  const Constants& constants{push_constants.constants};
+
+  cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+  heap->bind(cmd, vk::PipelineBindPoint::eCompute);
+  heap->push_constants(cmd, push_constants);
+  cmd.dispatch(
+    (constants.instance_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+    1,
+    1
+  );
+}
+
+auto CullPass::record_draw(const vk::raii::CommandBuffer& cmd) const -> void {
+  cmd.drawIndexedIndirectCount(
+    draw_buffer.get(),
+    0,
+    count_buffer.get(),
+    0,
+    push_constants.constants.instance_count,
+    sizeof(vk::DrawIndexedIndirectCommand)
+  );
+}
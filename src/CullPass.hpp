@@ -0,0 +1,87 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "BindlessHeap.hpp"
+#include "GpuAllocator.hpp"
+#include "PipelineCache.hpp"
+#include "RenderGraph.hpp"
+
+// GPU driven drawing of every instance of a mesh. A compute pass frustum
+// culls the instance buffer and compacts the survivors into indirect draw
+// commands plus a count, which vkCmdDrawIndexedIndirectCount consumes, so
+// the CPU cost of a frame no longer grows with the instance count.
+class CullPass {
+public:
+
+  // numthreads of cullMain in cull.slang
+  static constexpr u32 WORKGROUP_SIZE = 64;
+
+  // what record_cull does to the draw and count buffers
+  static constexpr RenderGraph::Access CULL_ACCESS{
+    .stages = vk::PipelineStageFlagBits2::eClear
+            | vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eTransferWrite
+            | vk::AccessFlagBits2::eShaderStorageRead
+            | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+
+  struct Constants {
+    u32 instance_count;
+    u32 index_count;
+    f32 bounds_radius;
+  };
+
+  // registers its buffers with heap and builds on its pipeline layout
+  auto init(
+    const vk::raii::Device& device,
+    GpuAllocator& allocator,
+    PipelineCache& pipeline_cache,
+    BindlessHeap& heap,
+    Span<const u32> spirv,
+    vk::Buffer instances,
+    const Constants& constants
+  ) -> void;
+
+  // the device must be idle, the heap slots are free again right away
+  auto clear() -> void;
+
+  // resets the draw count and culls, recorded outside of rendering, access
+  // to both buffers from other passes is synchronised by the render graph
+  auto record_cull(const vk::raii::CommandBuffer& cmd) const -> void;
+
+  // draws whatever record_cull kept, the graphics pipeline and the vertex /
+  // index buffers must already be bound
+  auto record_draw(const vk::raii::CommandBuffer& cmd) const -> void;
+
+  [[nodiscard]] auto get_draw_buffer() const -> vk::Buffer {
+    return *draw_buffer.get();
+  }
+
+  [[nodiscard]] auto get_count_buffer() const -> vk::Buffer {
+    return *count_buffer.get();
+  }
+
+private:
+
+  // matches CullConstants in cull.slang
+  struct PushConstants {
+    Constants constants;
+
+    // heap slots of the storage buffers
+    u32 instances;
+    u32 draws;
+    u32 draw_count;
+  };
+
+  BindlessHeap* heap{nullptr};
+  vk::raii::Pipeline pipeline{nullptr};
+
+  // one vk::DrawIndexedIndirectCommand per instance, worst case nothing is
+  // culled
+  GpuBuffer draw_buffer{};
+  GpuBuffer count_buffer{};
+
+  PushConstants push_constants{};
+};
@@ -0,0 +1,311 @@
+#include "DebugLog.hpp"
+#include <spdlog/spdlog.h>
+
+namespace {
+  constexpr u64 MASK = DebugLog::CAPACITY - 1;
+
+  static_assert((DebugLog::CAPACITY & MASK) == 0);
+
+  [[nodiscard]] auto to_level(const DebugLog::Severity severity)
+    -> spdlog::level::level_enum {
+    switch (severity) {
+      case DebugLog::Severity::eVerbose: return spdlog::level::trace;
+      case DebugLog::Severity::eInfo: return spdlog::level::info;
+      case DebugLog::Severity::eWarning: return spdlog::level::warn;
+      case DebugLog::Severity::eError: return spdlog::level::err;
+    }
+
+    return spdlog::level::trace;
+  }
+
+  [[nodiscard]] auto to_name(const DebugLog::Severity severity)
+    -> StringView {
+    switch (severity) {
+      case DebugLog::Severity::eVerbose: return "verbose";
+      case DebugLog::Severity::eInfo: return "info";
+      case DebugLog::Severity::eWarning: return "warning";
+      case DebugLog::Severity::eError: return "error";
+    }
+
+    return "unknown";
+  }
+
+  // returns true if text did not fit
+  template<usize N>
+  auto copy_truncated(std::array<char, N>& into, const StringView text)
+    -> bool {
+    const usize length{std::min(text.size(), N - 1)};
+    std::copy_n(text.begin(), length, into.begin());
+    into.at(length) = '\0';
+    return length != text.size();
+  }
+}
+
+DebugLog::DebugLog(): slots{std::make_unique<Slot[]>(CAPACITY)} {
+  for (u64 i = 0; i < CAPACITY; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+DebugLog::~DebugLog() { stop(); }
+
+auto DebugLog::start() -> void {
+  if (running.exchange(true)) {
+    return;
+  }
+
+  last_refill = Clock::now();
+  last_summary = last_refill;
+  logger = std::thread{[this] { logger_main(); }};
+}
+
+auto DebugLog::stop() -> void {
+  if (not running.exchange(false)) {
+    return;
+  }
+
+  logger.join();
+
+  drain();
+  log_summary();
+
+  u64 total{0};
+
+  for (const u64 count: totals) {
+    total += count;
+  }
+
+  if (total != 0) {
+    spdlog::info(
+      "Debug messages: {} errors, {} warnings, {} info, {} verbose, "
+      "{} unique ids",
+      totals[static_cast<usize>(Severity::eError)],
+      totals[static_cast<usize>(Severity::eWarning)],
+      totals[static_cast<usize>(Severity::eInfo)],
+      totals[static_cast<usize>(Severity::eVerbose)],
+      repeats.size()
+    );
+  }
+}
+
+auto DebugLog::push(
+  const Severity severity,
+  const vk::DebugUtilsMessageTypeFlagsEXT type,
+  const i32 id,
+  const StringView id_name,
+  const StringView text
+) -> void {
+  u64 position{head.load(std::memory_order_relaxed)};
+  Slot* slot{nullptr};
+
+  while (true) {
+    slot = &slots[position & MASK];
+
+    const u64 sequence{slot->sequence.load(std::memory_order_acquire)};
+    const auto difference =
+      static_cast<i64>(sequence) - static_cast<i64>(position);
+
+    if (difference == 0) {
+      // claim the slot, another producer may have beaten us to it
+      if (head.compare_exchange_weak(
+            position,
+            position + 1,
+            std::memory_order_relaxed
+          )) {
+        break;
+      }
+    } else if (difference < 0) {
+      // the consumer has not freed this slot yet, so the ring is full
+      overflowed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  Message& message{slot->message};
+  message.severity = severity;
+  message.type = type;
+  message.id = id;
+  copy_truncated(message.id_name, id_name);
+  message.truncated = copy_truncated(message.text, text);
+
+  slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+auto DebugLog::pop(Message& message) -> bool {
+  Slot& slot{slots[tail & MASK]};
+
+  if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+    return false;
+  }
+
+  message = slot.message;
+
+  // free for the producer one lap later
+  slot.sequence.store(tail + CAPACITY, std::memory_order_release);
+  tail++;
+
+  return true;
+}
+
+auto DebugLog::logger_main() -> void {
+  while (running.load(std::memory_order_acquire)) {
+    drain();
+
+    if (Clock::now() - last_summary >= SUMMARY_INTERVAL) {
+      log_summary();
+    }
+
+    std::this_thread::sleep_for(DRAIN_INTERVAL);
+  }
+}
+
+auto DebugLog::drain() -> void {
+  Message message{};
+  const Clock::time_point now{Clock::now()};
+
+  while (pop(message)) {
+    process(message, now);
+  }
+}
+
+auto DebugLog::process(const Message& message, const Clock::time_point now)
+  -> void {
+  totals[static_cast<usize>(message.severity)]++;
+
+  // id 0 is used by messages that do not have one, those are never repeats
+  if (message.id != 0) {
+    auto [found, inserted] = repeats.try_emplace(message.id);
+    Repeats& seen{found->second};
+    seen.total++;
+
+    if (not inserted) {
+      seen.since_summary++;
+      return;
+    }
+
+    seen.severity = message.severity;
+    seen.id_name = message.id_name.data();
+  }
+
+  if (not take_token(message.severity, now)) {
+    over_limit[static_cast<usize>(message.severity)]++;
+    return;
+  }
+
+  spdlog::log(
+    to_level(message.severity),
+    "Layer: {} {}: {}{}",
+    vk::to_string(message.type),
+    message.id_name.data(),
+    message.text.data(),
+    message.truncated ? " [truncated]" : ""
+  );
+}
+
+auto DebugLog::take_token(const Severity severity, const Clock::time_point now)
+  -> bool {
+  const std::chrono::duration<f64> elapsed{now - last_refill};
+  last_refill = now;
+
+  for (usize i = 0; i < SEVERITY_COUNT; i++) {
+    tokens[i] = std::min(
+      RATE_LIMITS[i],
+      tokens[i] + elapsed.count() * RATE_LIMITS[i]
+    );
+  }
+
+  f64& available{tokens[static_cast<usize>(severity)]};
+
+  if (available < 1.0) {
+    return false;
+  }
+
+  available -= 1.0;
+  return true;
+}
+
+auto DebugLog::log_summary() -> void {
+  last_summary = Clock::now();
+
+  for (auto& [id, seen]: repeats) {
+    if (seen.since_summary == 0) {
+      continue;
+    }
+
+    spdlog::log(
+      to_level(seen.severity),
+      "Layer: {} ({:#x}) repeated {} more times, {} in total",
+      seen.id_name,
+      static_cast<u32>(id),
+      seen.since_summary,
+      seen.total
+    );
+    seen.since_summary = 0;
+  }
+
+  for (usize i = 0; i < SEVERITY_COUNT; i++) {
+    if (over_limit[i] == 0) {
+      continue;
+    }
+
+    spdlog::warn(
+      "Layer: dropped {} {} messages over the {:.0f}/s limit",
+      over_limit[i],
+      to_name(static_cast<Severity>(i)),
+      RATE_LIMITS[i]
+    );
+    over_limit[i] = 0;
+  }
+
+  const u64 overflowed_total{overflowed.load(std::memory_order_relaxed)};
+
+  if (overflowed_total != overflowed_reported) {
+    spdlog::warn(
+      "Layer: dropped {} messages, the ring was full",
+      overflowed_total - overflowed_reported
+    );
+    overflowed_reported = overflowed_total;
+  }
+}
+
+auto DebugLog::callback(
+  const vk::DebugUtilsMessageSeverityFlagBitsEXT severity,
+  const vk::DebugUtilsMessageTypeFlagsEXT type,
+  const vk::DebugUtilsMessengerCallbackDataEXT* callback_data,
+  void* user_data
+) -> vk::Bool32 {
+  Severity mapped{Severity::eVerbose};
+
+  switch (severity) {
+    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo:
+      mapped = Severity::eInfo;
+      break;
+
+    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning:
+      mapped = Severity::eWarning;
+      break;
+
+    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eError:
+      mapped = Severity::eError;
+      break;
+
+    case vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose:
+    default: mapped = Severity::eVerbose; break;
+  }
+
+  const auto to_view = [](const char* text) {
+    return text == nullptr ? StringView{} : StringView{text};
+  };
+
+  static_cast<DebugLog*>(user_data)->push(
+    mapped,
+    type,
+    callback_data->messageIdNumber,
+    to_view(callback_data->pMessageIdName),
+    to_view(callback_data->pMessage)
+  );
+
+  return vk::False;
+}
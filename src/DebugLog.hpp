@@ -0,0 +1,142 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+
+// Sink for VK_EXT_debug_utils messages that keeps validation usable under
+// load.
+//
+// The callback runs on whatever thread the driver or layers fire it from, so
+// it only copies the message into a fixed size lock-free ring, dropping it if
+// the ring is full. A logger thread of its own drains the ring, logs the
+// first occurrence of every message id and counts the repeats, and holds
+// each severity to its own budget of messages per second. Repeats and
+// anything over budget are summarised once a second instead.
+class DebugLog {
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  // slots in the ring, a power of two
+  static constexpr usize CAPACITY = 1024;
+
+  // longer messages are truncated
+  static constexpr usize MAX_MESSAGE_LENGTH = 1024;
+  static constexpr usize MAX_ID_NAME_LENGTH = 64;
+
+  static constexpr std::chrono::milliseconds DRAIN_INTERVAL{5};
+  static constexpr std::chrono::seconds SUMMARY_INTERVAL{1};
+
+  enum class Severity : u8 {
+    eVerbose,
+    eInfo,
+    eWarning,
+    eError,
+  };
+
+  static constexpr usize SEVERITY_COUNT = 4;
+
+  // messages per second logged in full, per severity, also the burst size
+  static constexpr std::array<f64, SEVERITY_COUNT> RATE_LIMITS{
+    10.0,
+    20.0,
+    50.0,
+    100.0,
+  };
+
+  DebugLog();
+
+  DebugLog(const DebugLog&) = delete;
+  DebugLog(DebugLog&&) = delete;
+  auto operator=(const DebugLog&) -> DebugLog& = delete;
+  auto operator=(DebugLog&&) -> DebugLog& = delete;
+  ~DebugLog();
+
+  auto start() -> void;
+
+  // drains whatever is left and logs the totals, pushes after this are lost
+  auto stop() -> void;
+
+  // lock-free and never blocks, safe from any thread
+  auto push(
+    Severity severity,
+    vk::DebugUtilsMessageTypeFlagsEXT type,
+    i32 id,
+    StringView id_name,
+    StringView text
+  ) -> void;
+
+  // pfnUserCallback, pUserData must point at a DebugLog
+  static auto callback(
+    vk::DebugUtilsMessageSeverityFlagBitsEXT severity,
+    vk::DebugUtilsMessageTypeFlagsEXT type,
+    const vk::DebugUtilsMessengerCallbackDataEXT* callback_data,
+    void* user_data
+  ) -> vk::Bool32;
+
+private:
+
+  struct Message {
+    Severity severity{};
+    vk::DebugUtilsMessageTypeFlagsEXT type{};
+    i32 id{0};
+    bool truncated{false};
+    std::array<char, MAX_ID_NAME_LENGTH> id_name{};
+    std::array<char, MAX_MESSAGE_LENGTH> text{};
+  };
+
+  // bounded queue after Dmitry Vyukov's, sequence says whether the slot is
+  // free for the producer at that position or filled for the consumer
+  struct Slot {
+    std::atomic<u64> sequence{0};
+    Message message{};
+  };
+
+  struct Repeats {
+    Severity severity{};
+    String id_name{};
+    u64 total{0};
+    u64 since_summary{0};
+  };
+
+  auto logger_main() -> void;
+
+  // consumer side, returns false once the ring is empty
+  [[nodiscard]] auto pop(Message& message) -> bool;
+
+  auto drain() -> void;
+
+  auto process(const Message& message, Clock::time_point now) -> void;
+
+  // token bucket, false if severity is over budget
+  [[nodiscard]] auto take_token(Severity severity, Clock::time_point now)
+    -> bool;
+
+  auto log_summary() -> void;
+
+  std::unique_ptr<Slot[]> slots;
+
+  alignas(64) std::atomic<u64> head{0};
+  alignas(64) u64 tail{0};
+
+  // pushes lost to a full ring
+  std::atomic<u64> overflowed{0};
+
+  std::atomic<bool> running{false};
+  std::thread logger{};
+
+  // everything below belongs to the logger thread, or to stop() once it
+  // has been joined
+  std::map<i32, Repeats> repeats{};
+  std::array<f64, SEVERITY_COUNT> tokens{RATE_LIMITS};
+  std::array<u64, SEVERITY_COUNT> over_limit{};
+  std::array<u64, SEVERITY_COUNT> totals{};
+  Clock::time_point last_refill{};
+  Clock::time_point last_summary{};
+  u64 overflowed_reported{0};
+};
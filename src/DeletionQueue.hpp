@@ -0,0 +1,40 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <memory>
+
+// Holds on to resources that may still be referenced by in-flight GPU work
+// until the frame timeline passes the value they were retired at.
+class DeletionQueue {
+public:
+
+  // resource is destroyed once collect() is called with a value >= value
+  template<typename T>
+  auto push(const u64 value, T resource) -> void {
+    entries.push_back({
+      .value = value,
+      .resource = std::make_shared<T>(std::move(resource)),
+    });
+  }
+
+  auto collect(const u64 completed_value) -> void {
+    std::erase_if(entries, [completed_value](const Entry& entry) {
+      return entry.value <= completed_value;
+    });
+  }
+
+  auto flush() -> void { entries.clear(); }
+
+  [[nodiscard]] auto size() const -> usize { return entries.size(); }
+
+private:
+
+  struct Entry {
+    u64 value;
+
+    // type erased, shared_ptr<void> still runs the right destructor
+    std::shared_ptr<void> resource;
+  };
+
+  Vec<Entry> entries{};
+};
@@ -0,0 +1,67 @@
+#include "FrameArena.hpp"
+#include <spdlog/spdlog.h>
+#include <bit>
+#include <new>
+
+FrameArena::FrameArena(const usize capacity):
+    block{std::make_unique_for_overwrite<std::byte[]>(capacity)},
+    capacity{capacity} {}
+
+FrameArena::~FrameArena() { free_spills(); }
+
+auto FrameArena::reset() -> void {
+  const usize peak{used + spilled_bytes};
+  free_spills();
+  used = 0;
+
+  if (peak <= capacity) {
+    return;
+  }
+
+  // nothing may still point into the old block, so it is simply replaced
+  capacity = std::bit_ceil(peak);
+  block = std::make_unique_for_overwrite<std::byte[]>(capacity);
+
+  spdlog::debug("Frame arena grew to {} KiB", capacity >> 10);
+}
+
+auto FrameArena::do_allocate(const usize bytes, const usize alignment)
+  -> void* {
+  void* head{block.get() + used};
+  usize space{capacity - used};
+
+  if (std::align(alignment, bytes, head, space) != nullptr) {
+    used = static_cast<usize>(static_cast<std::byte*>(head) - block.get())
+         + bytes;
+    return head;
+  }
+
+  void* data{::operator new(bytes, std::align_val_t{alignment})};
+  spills.push_back({.data = data, .bytes = bytes, .alignment = alignment});
+
+  // the padding std::align could need counts too
+  spilled_bytes += bytes + alignment;
+  return data;
+}
+
+auto FrameArena::do_deallocate(void*, usize, usize) -> void {
+  // everything goes at once in reset()
+}
+
+auto FrameArena::do_is_equal(const std::pmr::memory_resource& other) const
+  noexcept -> bool {
+  return this == &other;
+}
+
+auto FrameArena::free_spills() -> void {
+  for (const Spill& spill: spills) {
+    ::operator delete(
+      spill.data,
+      spill.bytes,
+      std::align_val_t{spill.alignment}
+    );
+  }
+
+  spills.clear();
+  spilled_bytes = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <memory>
+#include <memory_resource>
+
+// Bump allocator for memory that lives for exactly one frame, usable as the
+// std::pmr resource of frame local containers. Allocating bumps a pointer
+// into one block, deallocating does nothing, and reset() drops everything
+// at once after the frame's timeline value has retired.
+//
+// A frame that outgrows the block spills into the heap, and the next reset()
+// regrows the block to that frame's peak, so a steady frame loop never
+// touches the heap. Not thread safe.
+class FrameArena final : public std::pmr::memory_resource {
+public:
+
+  static constexpr usize DEFAULT_CAPACITY = 64 << 10;
+
+  explicit FrameArena(usize capacity = DEFAULT_CAPACITY);
+
+  // moving is only for setting up the frames, nothing may point into it yet
+  FrameArena(const FrameArena&) = delete;
+  FrameArena(FrameArena&&) noexcept = default;
+  auto operator=(const FrameArena&) -> FrameArena& = delete;
+  auto operator=(FrameArena&&) noexcept -> FrameArena& = default;
+  ~FrameArena() override;
+
+  auto reset() -> void;
+
+  [[nodiscard]] auto get_capacity() const -> usize { return capacity; }
+
+  [[nodiscard]] auto get_used() const -> usize { return used; }
+
+private:
+
+  struct Spill {
+    void* data;
+    usize bytes;
+    usize alignment;
+  };
+
+  auto do_allocate(usize bytes, usize alignment) -> void* override;
+
+  auto do_deallocate(void* data, usize bytes, usize alignment)
+    -> void override;
+
+  [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource& other) const
+    noexcept -> bool override;
+
+  auto free_spills() -> void;
+
+  std::unique_ptr<std::byte[]> block{};
+  usize capacity{0};
+  usize used{0};
+
+  // everything that did not fit since the last reset
+  Vec<Spill> spills{};
+  usize spilled_bytes{0};
+};
@@ -0,0 +1,328 @@
+#include "FrameCapture.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <limits>
+
+namespace {
+  // every supported format is 8 bits per channel, 4 channels
+  constexpr vk::DeviceSize BYTES_PER_PIXEL = 4;
+
+  [[nodiscard]] auto is_bgra(const vk::Format format) -> bool {
+    return format == vk::Format::eB8G8R8A8Srgb
+        or format == vk::Format::eB8G8R8A8Unorm;
+  }
+}
+
+FrameCapture::~FrameCapture() { clear(); }
+
+auto FrameCapture::init(GpuAllocator& allocator, Config config) -> void {
+  std::error_code error{};
+  std::filesystem::create_directories(config.directory, error);
+
+  if (error) {
+    throw std::runtime_error{fmt::format(
+      "Failed to create capture directory '{}': {}",
+      config.directory.string(),
+      error.message()
+    )};
+  }
+
+  spdlog::info(
+    "Capturing frames to '{}' as {} through {} readback buffers",
+    config.directory.string(),
+    capture_format::get_name(config.format),
+    config.pool_size
+  );
+
+  this->allocator = &allocator;
+  this->config = std::move(config);
+  slots = Vec<Slot>(std::max(this->config.pool_size, 1u));
+  stopping = false;
+  writer = std::thread{[this] { writer_main(); }};
+}
+
+auto FrameCapture::clear() -> void {
+  if (not is_enabled()) {
+    return;
+  }
+
+  // the device is idle, so every copy is done
+  collect(std::numeric_limits<u64>::max());
+
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  writer.join();
+
+  raw_stream.close();
+  log_stats();
+
+  slots.clear();
+  allocator = nullptr;
+}
+
+auto FrameCapture::is_supported(const vk::Format format) -> bool {
+  return is_bgra(format) or format == vk::Format::eR8G8B8A8Srgb
+      or format == vk::Format::eR8G8B8A8Unorm;
+}
+
+auto FrameCapture::begin(
+  const u64 value,
+  const vk::Extent2D extent,
+  const vk::Format format
+) -> Option<u32> {
+  Slot* free_slot{nullptr};
+  u32 index{0};
+
+  {
+    std::lock_guard lock{mutex};
+
+    for (; index < slots.size(); index++) {
+      if (slots.at(index).state == State::eFree) {
+        free_slot = &slots.at(index);
+        free_slot->state = State::eCopying;
+        break;
+      }
+    }
+  }
+
+  // the writer is behind, keep rendering and lose this frame instead
+  if (free_slot == nullptr) {
+    dropped++;
+    return crab::none;
+  }
+
+  Slot& slot{*free_slot};
+  const vk::DeviceSize size{
+    static_cast<vk::DeviceSize>(extent.width) * extent.height * BYTES_PER_PIXEL
+  };
+
+  // only the render thread touches a slot while it is copying, so it can be
+  // regrown without the lock, which only happens after a resize
+  if (slot.size < size) {
+    const vk::BufferCreateInfo info{
+      .size = size,
+      .usage = vk::BufferUsageFlagBits::eTransferDst,
+      .sharingMode = vk::SharingMode::eExclusive,
+    };
+
+    // cached memory makes the writer's reads far cheaper where there is any
+    try {
+      slot.buffer = allocator->create_buffer(
+        info,
+        vk::MemoryPropertyFlagBits::eHostVisible
+          | vk::MemoryPropertyFlagBits::eHostCached
+      );
+    } catch (const std::runtime_error&) {
+      slot.buffer = allocator->create_buffer(
+        info,
+        vk::MemoryPropertyFlagBits::eHostVisible
+      );
+    }
+
+    slot.size = size;
+  }
+
+  slot.value = value;
+  slot.extent = extent;
+  slot.format = format;
+  captured++;
+
+  return index;
+}
+
+auto FrameCapture::record(
+  const vk::raii::CommandBuffer& cmd,
+  const u32 slot,
+  const vk::Image image
+) const -> void {
+  const Slot& found{slots.at(slot)};
+
+  cmd.copyImageToBuffer(
+    image,
+    vk::ImageLayout::eTransferSrcOptimal,
+    found.buffer.get(),
+    vk::BufferImageCopy{
+      .bufferOffset = 0,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = {
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .mipLevel = 0,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+      },
+      .imageOffset = {0, 0, 0},
+      .imageExtent = {found.extent.width, found.extent.height, 1},
+    }
+  );
+
+  // waiting on the timeline alone does not make device writes visible to
+  // the host
+  const vk::BufferMemoryBarrier2 copied{
+    .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+    .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+    .buffer = found.buffer.get(),
+    .offset = 0,
+    .size = vk::WholeSize,
+  };
+
+  cmd.pipelineBarrier2({
+    .bufferMemoryBarrierCount = 1,
+    .pBufferMemoryBarriers = &copied,
+  });
+}
+
+auto FrameCapture::collect(const u64 completed_value) -> void {
+  bool handed_over{false};
+
+  {
+    std::lock_guard lock{mutex};
+
+    for (u32 i = 0; i < slots.size(); i++) {
+      Slot& slot{slots.at(i)};
+
+      if (slot.state != State::eCopying or slot.value > completed_value) {
+        continue;
+      }
+
+      slot.state = State::eWriting;
+      queue.push_back(i);
+      handed_over = true;
+    }
+  }
+
+  if (handed_over) {
+    wake.notify_one();
+  }
+}
+
+auto FrameCapture::log_stats() const -> void {
+  spdlog::info(
+    "Frame capture: {} captured, {} dropped, {} written ({:.1f} MiB)",
+    captured,
+    dropped,
+    written,
+    static_cast<f64>(written_bytes) / (1024.0 * 1024.0)
+  );
+}
+
+auto FrameCapture::writer_main() -> void {
+  while (true) {
+    u32 index{0};
+
+    {
+      std::unique_lock lock{mutex};
+      wake.wait(lock, [this] { return stopping or not queue.empty(); });
+
+      // everything handed over before stopping is still written
+      if (queue.empty()) {
+        return;
+      }
+
+      index = queue.front();
+      queue.pop_front();
+    }
+
+    // a slot that is being written is left alone by the render thread
+    const Slot& slot{slots.at(index)};
+    write(slot);
+
+    std::lock_guard lock{mutex};
+    slots.at(index).state = State::eFree;
+    written++;
+    written_bytes += static_cast<u64>(slot.extent.width) * slot.extent.height
+                   * BYTES_PER_PIXEL;
+  }
+}
+
+auto FrameCapture::write(const Slot& slot) -> void {
+  switch (config.format) {
+    case CaptureFormat::ePpm: write_ppm(slot); return;
+    case CaptureFormat::eRaw: write_raw(slot); return;
+  }
+}
+
+auto FrameCapture::write_ppm(const Slot& slot) -> void {
+  const std::filesystem::path path{
+    config.directory / fmt::format("frame_{:06}.ppm", slot.value)
+  };
+
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+
+  if (not file) {
+    spdlog::error("Failed to open '{}' for writing", path.string());
+    return;
+  }
+
+  const usize pixel_count{
+    static_cast<usize>(slot.extent.width) * slot.extent.height
+  };
+  const u8* pixels{slot.buffer.mapped()};
+  const bool swizzle{is_bgra(slot.format)};
+
+  rgb.resize(pixel_count * 3);
+
+  for (usize i = 0; i < pixel_count; i++) {
+    const u8* pixel{pixels + i * BYTES_PER_PIXEL};
+    rgb[i * 3 + 0] = pixel[swizzle ? 2 : 0];
+    rgb[i * 3 + 1] = pixel[1];
+    rgb[i * 3 + 2] = pixel[swizzle ? 0 : 2];
+  }
+
+  file << fmt::format(
+    "P6\n{} {}\n255\n",
+    slot.extent.width,
+    slot.extent.height
+  );
+  file.write(
+    reinterpret_cast<const char*>(rgb.data()),
+    static_cast<std::streamsize>(rgb.size())
+  );
+}
+
+auto FrameCapture::write_raw(const Slot& slot) -> void {
+  if (not raw_stream.is_open()) {
+    const std::filesystem::path path{config.directory / "frames.raw"};
+    raw_stream.open(path, std::ios::binary | std::ios::trunc);
+
+    if (not raw_stream) {
+      spdlog::error("Failed to open '{}' for writing", path.string());
+      return;
+    }
+
+    raw_extent = slot.extent;
+    spdlog::info(
+      "Streaming raw frames to '{}', {}x{} {}",
+      path.string(),
+      raw_extent.width,
+      raw_extent.height,
+      is_bgra(slot.format) ? "bgra" : "rgba"
+    );
+  }
+
+  // a raw stream has no headers, frames of another size would corrupt it
+  if (slot.extent != raw_extent) {
+    spdlog::warn(
+      "Dropping captured frame {} at {}x{}, the raw stream is {}x{}",
+      slot.value,
+      slot.extent.width,
+      slot.extent.height,
+      raw_extent.width,
+      raw_extent.height
+    );
+    return;
+  }
+
+  raw_stream.write(
+    reinterpret_cast<const char*>(slot.buffer.mapped()),
+    static_cast<std::streamsize>(
+      static_cast<vk::DeviceSize>(slot.extent.width) * slot.extent.height
+      * BYTES_PER_PIXEL
+    )
+  );
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "GpuAllocator.hpp"
+
+enum class CaptureFormat {
+  // one binary PPM per frame, RGB
+  ePpm,
+
+  // every frame appended to frames.raw as is, for ffmpeg -f rawvideo
+  eRaw,
+};
+
+namespace capture_format {
+  [[nodiscard]] constexpr auto get_name(const CaptureFormat format)
+    -> StringView {
+    switch (format) {
+      case CaptureFormat::ePpm: return "ppm";
+      case CaptureFormat::eRaw: return "raw";
+    }
+
+    return "unknown";
+  }
+
+  [[nodiscard]] inline auto parse(const StringView name)
+    -> Option<CaptureFormat> {
+    for (const CaptureFormat format: {CaptureFormat::ePpm, CaptureFormat::eRaw}
+    ) {
+      if (get_name(format) == name) {
+        return format;
+      }
+    }
+
+    return crab::none;
+  }
+}
+
+// Streams rendered frames to disk without the render loop ever waiting on
+// the GPU or on I/O.
+//
+// Each captured frame copies the final colour image into one of a small
+// pool of persistently mapped, host visible buffers. Once the frame
+// timeline passes that frame the buffer goes to a writer thread of its own,
+// and comes back to the pool when the file is written. A frame that finds
+// every buffer still in use is dropped rather than waited for.
+class FrameCapture {
+public:
+
+  static constexpr u32 DEFAULT_POOL_SIZE = 4;
+
+  struct Config {
+    std::filesystem::path directory;
+    CaptureFormat format{CaptureFormat::ePpm};
+    u32 pool_size{DEFAULT_POOL_SIZE};
+  };
+
+  FrameCapture() = default;
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture(FrameCapture&&) = delete;
+  auto operator=(const FrameCapture&) -> FrameCapture& = delete;
+  auto operator=(FrameCapture&&) -> FrameCapture& = delete;
+  ~FrameCapture();
+
+  auto init(GpuAllocator& allocator, Config config) -> void;
+
+  // writes out everything still pending and stops the writer, the device
+  // must be idle
+  auto clear() -> void;
+
+  [[nodiscard]] auto is_enabled() const -> bool { return allocator != nullptr; }
+
+  // formats the writer knows how to turn into pixels
+  [[nodiscard]] static auto is_supported(vk::Format format) -> bool;
+
+  // a buffer for the frame that signals value, none if the frame has to be
+  // dropped
+  [[nodiscard]] auto begin(u64 value, vk::Extent2D extent, vk::Format format)
+    -> Option<u32>;
+
+  // copies image, in eTransferSrcOptimal, into the buffer begin() returned
+  // and makes it visible to the host
+  auto record(const vk::raii::CommandBuffer& cmd, u32 slot, vk::Image image)
+    const -> void;
+
+  // hands every copy the GPU has finished over to the writer
+  auto collect(u64 completed_value) -> void;
+
+  auto log_stats() const -> void;
+
+private:
+
+  enum class State {
+    eFree,
+    eCopying,
+    eWriting,
+  };
+
+  struct Slot {
+    GpuBuffer buffer{};
+    vk::DeviceSize size{0};
+    State state{State::eFree};
+    u64 value{0};
+    vk::Extent2D extent{};
+    vk::Format format{vk::Format::eUndefined};
+  };
+
+  auto writer_main() -> void;
+
+  auto write(const Slot& slot) -> void;
+
+  auto write_ppm(const Slot& slot) -> void;
+
+  auto write_raw(const Slot& slot) -> void;
+
+  GpuAllocator* allocator{nullptr};
+  Config config{};
+  Vec<Slot> slots{};
+
+  // guards every slot's state and the queue, never held during I/O
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  std::deque<u32> queue{};
+  bool stopping{false};
+  std::thread writer{};
+
+  // the writer thread's own
+  std::ofstream raw_stream{};
+  vk::Extent2D raw_extent{};
+  Vec<u8> rgb{};
+
+  // render thread only
+  u64 captured{0};
+  u64 dropped{0};
+
+  // under mutex
+  u64 written{0};
+  u64 written_bytes{0};
+};
@@ -0,0 +1,98 @@
+#include "FramePacer.hpp"
+#include <thread>
+
+namespace {
+  // a frame loop with one frame in flight on a FIFO swapchain of two images,
+  // checked at compile time against the update rule
+  struct Loop {
+    f64 refresh_ms;
+    f64 gpu_ms;
+    f64 work_ms;
+  };
+
+  struct Outcome {
+    f64 delay_ms;
+    f64 period_ms;
+  };
+
+  [[nodiscard]] constexpr auto next_vblank(const f64 time, const f64 refresh)
+    -> f64 {
+    const f64 vblank{static_cast<f64>(static_cast<u64>(time / refresh))
+                     * refresh};
+    return vblank < time ? vblank + refresh : vblank;
+  }
+
+  [[nodiscard]] constexpr auto simulate(const Loop loop, const u32 frames)
+    -> Outcome {
+    f64 now{0.0};
+    f64 gpu_done{0.0};
+    f64 shown{0.0};
+    f64 ready{0.0};
+    f64 delay{0.0};
+    f64 period{0.0};
+
+    for (u32 i = 0; i < frames; i++) {
+      // the frame slot wait, the GPU's work is never slack
+      now = std::max(now, gpu_done);
+
+      // an image comes back once the previous frame replaces it on screen
+      const f64 acquiring{now};
+      now = std::max(now, shown);
+      delay = FramePacer::next_delay(
+        delay,
+        now - acquiring,
+        FramePacer::DEFAULT_MARGIN_MS
+      );
+
+      period = now - ready;
+      ready = now;
+
+      now += delay + loop.work_ms;
+      gpu_done = now + loop.gpu_ms;
+      shown = std::max(
+        next_vblank(gpu_done, loop.refresh_ms),
+        shown + loop.refresh_ms
+      );
+    }
+
+    return {.delay_ms = delay, .period_ms = period};
+  }
+
+  // GPU bound, the sleep must not build up and stretch the frame
+  constexpr Outcome GPU_BOUND{
+    simulate({.refresh_ms = 1.0, .gpu_ms = 5.0, .work_ms = 1.0}, 1000)
+  };
+  static_assert(GPU_BOUND.delay_ms == 0.0);
+  static_assert(GPU_BOUND.period_ms <= 7.0);
+
+  // presentation bound, the sleep takes the slack but keeps the refresh rate
+  constexpr Outcome PRESENT_BOUND{
+    simulate({.refresh_ms = 16.0, .gpu_ms = 5.0, .work_ms = 1.0}, 1000)
+  };
+  static_assert(PRESENT_BOUND.delay_ms > 7.5 and PRESENT_BOUND.delay_ms < 8.5);
+  static_assert(PRESENT_BOUND.period_ms == 16.0);
+}
+
+auto FramePacer::mark_acquiring() -> void { acquiring = Clock::now(); }
+
+auto FramePacer::wait_for_sample() -> void {
+  const Clock::time_point ready{Clock::now()};
+  const std::chrono::duration<f64, std::milli> blocked{ready - acquiring};
+
+  if (not enabled) {
+    return;
+  }
+
+  delay_ms = next_delay(delay_ms, blocked.count(), margin_ms);
+
+  if (delay_ms <= 0.0) {
+    return;
+  }
+
+  std::this_thread::sleep_until(
+    ready
+    + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<f64, std::milli>{delay_ms}
+    )
+  );
+}
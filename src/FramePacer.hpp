@@ -0,0 +1,57 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <algorithm>
+#include <chrono>
+
+// Delays input sampling so that a frame is recorded and submitted just
+// before the swapchain would have let it in anyway, rather than sampling
+// early and sitting in a queue.
+//
+// Only time spent blocked in acquiring swapchain images is taken as slack:
+// that is presentation holding the frame back, and sleeping through it does
+// not move the next image any later. The frame slot wait is left out, with
+// few frames in flight it is the GPU's own work and sleeping would only add
+// to it. The delay is nudged each frame until that blocking is down to the
+// margin, so it settles at the slack presentation leaves and falls to zero
+// whenever there is none, pacing never caps the frame rate.
+class FramePacer {
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  // headroom for scheduling jitter and the GPU's share of the frame
+  static constexpr f64 DEFAULT_MARGIN_MS = 2.0;
+
+  // share of the difference between blocking and margin applied per frame
+  static constexpr f64 SMOOTHING = 0.1;
+
+  auto set_enabled(const bool enabled) -> void { this->enabled = enabled; }
+
+  auto set_margin(const f64 margin_ms) -> void { this->margin_ms = margin_ms; }
+
+  // the frame slot is free, the swapchain images are about to be acquired
+  auto mark_acquiring() -> void;
+
+  // sleeps until input should be sampled, call right before sampling
+  auto wait_for_sample() -> void;
+
+  [[nodiscard]] auto get_delay_ms() const -> f64 { return delay_ms; }
+
+  // the delay after a frame that blocked for blocked_ms in its acquires
+  [[nodiscard]] static constexpr auto next_delay(
+    const f64 delay_ms,
+    const f64 blocked_ms,
+    const f64 margin_ms
+  ) -> f64 {
+    return std::max(delay_ms + (blocked_ms - margin_ms) * SMOOTHING, 0.0);
+  }
+
+private:
+
+  bool enabled{false};
+  f64 margin_ms{DEFAULT_MARGIN_MS};
+
+  Clock::time_point acquiring{};
+  f64 delay_ms{0.0};
+};
@@ -0,0 +1,490 @@
+#include "GpuAllocator.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <utility>
+
+GpuBuffer::GpuBuffer(
+  GpuAllocator& allocator,
+  vk::raii::Buffer buffer,
+  GpuAllocation allocation
+):
+    allocator{&allocator}, buffer{std::move(buffer)}, allocation{allocation} {}
+
+GpuBuffer::GpuBuffer(GpuBuffer&& other) noexcept:
+    allocator{std::exchange(other.allocator, nullptr)},
+    buffer{std::move(other.buffer)},
+    allocation{other.allocation} {}
+
+auto GpuBuffer::operator=(GpuBuffer&& other) noexcept -> GpuBuffer& {
+  if (this != &other) {
+    reset();
+    allocator = std::exchange(other.allocator, nullptr);
+    buffer = std::move(other.buffer);
+    allocation = other.allocation;
+  }
+  return *this;
+}
+
+GpuBuffer::~GpuBuffer() { reset(); }
+
+auto GpuBuffer::reset() -> void {
+  buffer.clear();
+
+  if (allocator != nullptr) {
+    allocator->free(allocation);
+    allocator = nullptr;
+  }
+}
+
+GpuImage::GpuImage(
+  GpuAllocator& allocator,
+  vk::raii::Image image,
+  GpuAllocation allocation
+):
+    allocator{&allocator}, image{std::move(image)}, allocation{allocation} {}
+
+GpuImage::GpuImage(GpuImage&& other) noexcept:
+    allocator{std::exchange(other.allocator, nullptr)},
+    image{std::move(other.image)},
+    allocation{other.allocation} {}
+
+auto GpuImage::operator=(GpuImage&& other) noexcept -> GpuImage& {
+  if (this != &other) {
+    reset();
+    allocator = std::exchange(other.allocator, nullptr);
+    image = std::move(other.image);
+    allocation = other.allocation;
+  }
+  return *this;
+}
+
+GpuImage::~GpuImage() { reset(); }
+
+auto GpuImage::reset() -> void {
+  image.clear();
+
+  if (allocator != nullptr) {
+    allocator->free(allocation);
+    allocator = nullptr;
+  }
+}
+
+auto GpuAllocator::init(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physical_device,
+  const u32 frames_in_flight
+) -> void {
+  this->device = &device;
+  memory_properties = physical_device.getMemoryProperties();
+  max_allocations =
+    physical_device.getProperties().limits.maxMemoryAllocationCount;
+
+  // don't let a single block claim a large chunk of a small heap (eg. the
+  // 256MiB host visible + device local heap on discrete cards)
+  vk::DeviceSize smallest_heap{DEFAULT_BLOCK_SIZE * 8};
+  for (u32 i = 0; i < memory_properties.memoryHeapCount; i++) {
+    smallest_heap =
+      std::min(smallest_heap, memory_properties.memoryHeaps.at(i).size);
+  }
+
+  block_size = std::max<vk::DeviceSize>(
+    BuddyAllocator::next_power_of_two(smallest_heap / 8 + 1) / 2,
+    MIN_BUDDY_BLOCK_SIZE
+  );
+  block_size = std::min(block_size, DEFAULT_BLOCK_SIZE);
+
+  frames.clear();
+  frames.resize(frames_in_flight);
+
+  const usize frame_block_lists{
+    static_cast<usize>(memory_properties.memoryTypeCount) * RESOURCE_KIND_COUNT
+  };
+
+  for (FrameArena& frame: frames) {
+    frame.blocks.resize(frame_block_lists);
+    frame.current.resize(frame_block_lists, 0);
+  }
+
+  spdlog::info(
+    "GPU allocator: {}MiB blocks, {} frame arenas",
+    block_size >> 20,
+    frames_in_flight
+  );
+}
+
+auto GpuAllocator::clear() -> void {
+  std::lock_guard lock{mutex};
+
+  pools.clear();
+  frames.clear();
+  dedicated.clear();
+  device_allocations = 0;
+  reserved_bytes = 0;
+}
+
+auto GpuAllocator::find_memory_type(
+  const u32 type_filter,
+  const vk::MemoryPropertyFlags properties
+) const -> u32 {
+  for (u32 i = 0; i < memory_properties.memoryTypeCount; i++) {
+    const bool allowed = (type_filter & (1u << i)) != 0;
+    const bool has_properties =
+      (memory_properties.memoryTypes.at(i).propertyFlags & properties)
+      == properties;
+
+    if (allowed and has_properties) {
+      return i;
+    }
+  }
+
+  throw std::runtime_error{"Failed to find a suitable memory type"};
+}
+
+auto GpuAllocator::allocate(
+  const vk::MemoryRequirements& requirements,
+  vk::MemoryPropertyFlags properties,
+  const ResourceKind kind,
+  const AllocationLifetime lifetime
+) -> GpuAllocation {
+  // mapped memory is always persistently mapped, prefer coherent so callers
+  // never need to flush
+  if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+    properties |= vk::MemoryPropertyFlagBits::eHostCoherent;
+  }
+
+  const u32 memory_type{
+    find_memory_type(requirements.memoryTypeBits, properties)
+  };
+
+  std::lock_guard lock{mutex};
+
+  if (lifetime == AllocationLifetime::eFrame) {
+    return allocate_frame(requirements, memory_type, kind);
+  }
+
+  return allocate_persistent(requirements, memory_type, kind);
+}
+
+auto GpuAllocator::allocate_persistent(
+  const vk::MemoryRequirements& requirements,
+  const u32 memory_type,
+  const ResourceKind kind
+) -> GpuAllocation {
+  requested_bytes += requirements.size;
+
+  // large resources would waste most of a buddy block to rounding
+  if (requirements.size > block_size / 2) {
+    auto [memory, mapped] = allocate_memory(requirements.size, memory_type);
+
+    const GpuAllocation allocation{
+      .memory = memory,
+      .offset = 0,
+      .size = requirements.size,
+      .mapped = mapped,
+      .lifetime = AllocationLifetime::ePersistent,
+      .memory_type = memory_type,
+      .pool = 0,
+      .block = GpuAllocation::DEDICATED,
+    };
+
+    const VkDeviceMemory handle{*memory};
+    dedicated.emplace(handle, std::move(memory));
+    return allocation;
+  }
+
+  const u32 pool_index{get_pool(memory_type, kind)};
+  Pool& pool{pools.at(pool_index)};
+
+  for (u32 i = 0; i <= pool.blocks.size(); i++) {
+    if (i == pool.blocks.size()) {
+      auto [memory, mapped] = allocate_memory(block_size, memory_type);
+
+      pool.blocks.push_back(std::make_unique<Block>(Block{
+        .memory = std::move(memory),
+        .mapped = mapped,
+        .buddy = BuddyAllocator{block_size, MIN_BUDDY_BLOCK_SIZE},
+      }));
+    }
+
+    Block& block{*pool.blocks.at(i)};
+
+    const Option<u64> offset{
+      block.buddy.allocate(requirements.size, requirements.alignment)
+    };
+
+    if (offset.is_none()) {
+      continue;
+    }
+
+    const u64 block_offset{offset.get_unchecked()};
+    wasted_bytes += block.buddy.block_size(block_offset) - requirements.size;
+
+    return GpuAllocation{
+      .memory = block.memory,
+      .offset = block_offset,
+      .size = requirements.size,
+      .mapped = block.mapped == nullptr
+                ? nullptr
+                : static_cast<u8*>(block.mapped) + block_offset,
+      .lifetime = AllocationLifetime::ePersistent,
+      .memory_type = memory_type,
+      .pool = pool_index,
+      .block = i,
+    };
+  }
+
+  // a fresh block always fits anything <= block_size / 2
+  throw std::logic_error{"unreachable"};
+}
+
+auto GpuAllocator::get_frame_list(
+  const u32 memory_type,
+  const ResourceKind kind
+) -> usize {
+  return static_cast<usize>(memory_type) * RESOURCE_KIND_COUNT
+       + static_cast<usize>(kind);
+}
+
+auto GpuAllocator::allocate_frame(
+  const vk::MemoryRequirements& requirements,
+  const u32 memory_type,
+  const ResourceKind kind
+) -> GpuAllocation {
+  // kept apart by kind like the pools, so neighbours in a block never need
+  // bufferImageGranularity padding
+  const usize list{get_frame_list(memory_type, kind)};
+  FrameArena& frame{frames.at(current_frame)};
+  Vec<std::unique_ptr<FrameBlock>>& blocks{frame.blocks.at(list)};
+  usize& current{frame.current.at(list)};
+
+  while (true) {
+    if (current == blocks.size()) {
+      const vk::DeviceSize size{std::max(
+        FRAME_BLOCK_SIZE,
+        BuddyAllocator::next_power_of_two(requirements.size)
+      )};
+
+      auto [memory, mapped] = allocate_memory(size, memory_type);
+
+      blocks.push_back(std::make_unique<FrameBlock>(FrameBlock{
+        .memory = std::move(memory),
+        .mapped = mapped,
+        .linear = LinearAllocator{size},
+      }));
+    }
+
+    FrameBlock& block{*blocks.at(current)};
+
+    const Option<u64> offset{
+      block.linear.allocate(requirements.size, requirements.alignment)
+    };
+
+    if (offset.is_none()) {
+      current++;
+      continue;
+    }
+
+    const u64 block_offset{offset.get_unchecked()};
+
+    vk::DeviceSize frame_bytes{0};
+    for (usize i = 0; i <= current; i++) {
+      frame_bytes += blocks.at(i)->linear.get_used();
+    }
+    peak_frame_bytes = std::max(peak_frame_bytes, frame_bytes);
+
+    return GpuAllocation{
+      .memory = block.memory,
+      .offset = block_offset,
+      .size = requirements.size,
+      .mapped = block.mapped == nullptr
+                ? nullptr
+                : static_cast<u8*>(block.mapped) + block_offset,
+      .lifetime = AllocationLifetime::eFrame,
+      .memory_type = memory_type,
+      .pool = current_frame,
+      .block = static_cast<u32>(current),
+    };
+  }
+}
+
+auto GpuAllocator::free(const GpuAllocation& allocation) -> void {
+  // released wholesale by begin_frame
+  if (allocation.lifetime == AllocationLifetime::eFrame) {
+    return;
+  }
+
+  std::lock_guard lock{mutex};
+
+  requested_bytes -= allocation.size;
+
+  if (allocation.block == GpuAllocation::DEDICATED) {
+    const VkDeviceMemory handle{allocation.memory};
+
+    if (dedicated.erase(handle) != 0) {
+      device_allocations--;
+      reserved_bytes -= allocation.size;
+    }
+    return;
+  }
+
+  // the pools may already be gone if clear() ran first during shutdown
+  if (allocation.pool >= pools.size()) {
+    return;
+  }
+
+  Block& block{*pools.at(allocation.pool).blocks.at(allocation.block)};
+
+  wasted_bytes -= block.buddy.block_size(allocation.offset) - allocation.size;
+  block.buddy.free(allocation.offset);
+}
+
+auto GpuAllocator::begin_frame(const u32 frame_index) -> void {
+  std::lock_guard lock{mutex};
+
+  current_frame = frame_index % static_cast<u32>(frames.size());
+  FrameArena& frame{frames.at(current_frame)};
+
+  for (Vec<std::unique_ptr<FrameBlock>>& blocks: frame.blocks) {
+    for (std::unique_ptr<FrameBlock>& block: blocks) {
+      block->linear.reset();
+    }
+  }
+
+  ranges::fill(frame.current, 0);
+}
+
+auto GpuAllocator::create_buffer(
+  const vk::BufferCreateInfo& info,
+  const vk::MemoryPropertyFlags properties,
+  const AllocationLifetime lifetime
+) -> GpuBuffer {
+  vk::raii::Buffer buffer{*device, info};
+
+  const GpuAllocation allocation{allocate(
+    buffer.getMemoryRequirements(),
+    properties,
+    ResourceKind::eBuffer,
+    lifetime
+  )};
+
+  buffer.bindMemory(allocation.memory, allocation.offset);
+
+  return GpuBuffer{*this, std::move(buffer), allocation};
+}
+
+auto GpuAllocator::create_image(
+  const vk::ImageCreateInfo& info,
+  const vk::MemoryPropertyFlags properties,
+  const AllocationLifetime lifetime
+) -> GpuImage {
+  vk::raii::Image image{*device, info};
+
+  const ResourceKind kind{
+    info.tiling == vk::ImageTiling::eLinear ? ResourceKind::eBuffer
+                                            : ResourceKind::eImage
+  };
+
+  const GpuAllocation allocation{
+    allocate(image.getMemoryRequirements(), properties, kind, lifetime)
+  };
+
+  image.bindMemory(allocation.memory, allocation.offset);
+
+  return GpuImage{*this, std::move(image), allocation};
+}
+
+auto GpuAllocator::allocate_memory(
+  const vk::DeviceSize size,
+  const u32 memory_type
+) -> std::pair<vk::raii::DeviceMemory, void*> {
+  if (max_allocations != 0 and device_allocations >= max_allocations) {
+    throw std::runtime_error{fmt::format(
+      "Exceeded maxMemoryAllocationCount ({})",
+      max_allocations
+    )};
+  }
+
+  vk::raii::DeviceMemory memory{
+    *device,
+    vk::MemoryAllocateInfo{
+      .allocationSize = size,
+      .memoryTypeIndex = memory_type,
+    },
+  };
+
+  device_allocations++;
+  reserved_bytes += size;
+
+  void* mapped{nullptr};
+
+  const vk::MemoryPropertyFlags flags{
+    memory_properties.memoryTypes.at(memory_type).propertyFlags
+  };
+
+  if (flags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    mapped = memory.mapMemory(0, vk::WholeSize);
+  }
+
+  return {std::move(memory), mapped};
+}
+
+auto GpuAllocator::get_pool(const u32 memory_type, const ResourceKind kind)
+  -> u32 {
+  for (u32 i = 0; i < pools.size(); i++) {
+    if (pools.at(i).memory_type == memory_type and pools.at(i).kind == kind) {
+      return i;
+    }
+  }
+
+  pools.push_back(Pool{.memory_type = memory_type, .kind = kind});
+  return static_cast<u32>(pools.size() - 1);
+}
+
+auto GpuAllocator::get_stats() const -> Stats {
+  std::lock_guard lock{mutex};
+
+  f64 fragmentation{0.0};
+  u32 block_count{0};
+
+  for (const Pool& pool: pools) {
+    for (const std::unique_ptr<Block>& block: pool.blocks) {
+      const u64 free_bytes{block->buddy.get_free_bytes()};
+      block_count++;
+
+      if (free_bytes == 0) {
+        continue;
+      }
+
+      fragmentation += 1.0
+                     - static_cast<f64>(block->buddy.largest_free_block())
+                         / static_cast<f64>(free_bytes);
+    }
+  }
+
+  return Stats{
+    .device_allocations = device_allocations,
+    .max_device_allocations = max_allocations,
+    .reserved_bytes = reserved_bytes,
+    .requested_bytes = requested_bytes,
+    .wasted_bytes = wasted_bytes,
+    .fragmentation =
+      block_count == 0 ? 0.0 : fragmentation / static_cast<f64>(block_count),
+    .peak_frame_bytes = peak_frame_bytes,
+  };
+}
+
+auto GpuAllocator::log_stats() const -> void {
+  const Stats stats{get_stats()};
+
+  spdlog::info(
+    "GPU allocator: {}/{} device allocations, {} KiB reserved, {} KiB in use, "
+    "{} KiB wasted, {:.1f}% fragmented, {} KiB peak per frame",
+    stats.device_allocations,
+    stats.max_device_allocations,
+    stats.reserved_bytes >> 10,
+    stats.requested_bytes >> 10,
+    stats.wasted_bytes >> 10,
+    stats.fragmentation * 100.0,
+    stats.peak_frame_bytes >> 10
+  );
+}
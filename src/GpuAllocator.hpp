@@ -0,0 +1,272 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "BuddyAllocator.hpp"
+
+enum class AllocationLifetime {
+  // buddy sub-allocated out of the pool for its memory type, freed explicitly
+  ePersistent,
+
+  // bump allocated out of the current frame's linear block, released in bulk
+  // when that frame slot is reused
+  eFrame,
+};
+
+// Resources with linear and optimal tiling are kept in separate pools so
+// bufferImageGranularity never has to be accounted for inside a block.
+enum class ResourceKind {
+  eBuffer,
+  eImage,
+};
+
+struct GpuAllocation {
+  vk::DeviceMemory memory{};
+  vk::DeviceSize offset{0};
+  vk::DeviceSize size{0};
+
+  // persistently mapped pointer to offset, null unless host visible
+  void* mapped{nullptr};
+
+  AllocationLifetime lifetime{AllocationLifetime::ePersistent};
+  u32 memory_type{0};
+  u32 pool{0};
+
+  // index of the pool block, or DEDICATED for a standalone vkAllocateMemory
+  u32 block{0};
+
+  static constexpr u32 DEDICATED = std::numeric_limits<u32>::max();
+};
+
+class GpuAllocator;
+
+// Buffer that returns its memory to the allocator when destroyed.
+class GpuBuffer {
+public:
+
+  GpuBuffer() = default;
+  GpuBuffer(
+    GpuAllocator& allocator,
+    vk::raii::Buffer buffer,
+    GpuAllocation allocation
+  );
+
+  GpuBuffer(const GpuBuffer&) = delete;
+  GpuBuffer(GpuBuffer&& other) noexcept;
+  auto operator=(const GpuBuffer&) -> GpuBuffer& = delete;
+  auto operator=(GpuBuffer&& other) noexcept -> GpuBuffer&;
+  ~GpuBuffer();
+
+  [[nodiscard]] auto get() const -> const vk::raii::Buffer& { return buffer; }
+
+  [[nodiscard]] auto get_allocation() const -> const GpuAllocation& {
+    return allocation;
+  }
+
+  [[nodiscard]] auto mapped() const -> u8* {
+    return static_cast<u8*>(allocation.mapped);
+  }
+
+  auto reset() -> void;
+
+private:
+
+  GpuAllocator* allocator{nullptr};
+  vk::raii::Buffer buffer{nullptr};
+  GpuAllocation allocation{};
+};
+
+// Image that returns its memory to the allocator when destroyed.
+class GpuImage {
+public:
+
+  GpuImage() = default;
+  GpuImage(
+    GpuAllocator& allocator,
+    vk::raii::Image image,
+    GpuAllocation allocation
+  );
+
+  GpuImage(const GpuImage&) = delete;
+  GpuImage(GpuImage&& other) noexcept;
+  auto operator=(const GpuImage&) -> GpuImage& = delete;
+  auto operator=(GpuImage&& other) noexcept -> GpuImage&;
+  ~GpuImage();
+
+  [[nodiscard]] auto get() const -> const vk::raii::Image& { return image; }
+
+  [[nodiscard]] auto get_allocation() const -> const GpuAllocation& {
+    return allocation;
+  }
+
+  auto reset() -> void;
+
+private:
+
+  GpuAllocator* allocator{nullptr};
+  vk::raii::Image image{nullptr};
+  GpuAllocation allocation{};
+};
+
+// Sub-allocates device memory out of large blocks so resources never hit
+// maxMemoryAllocationCount or pay for a vkAllocateMemory each.
+//
+// * every (memory type, resource kind) pair has its own pool of blocks
+// * long lived allocations are buddy allocated inside the pool's blocks
+// * per frame allocations bump allocate out of linear blocks per frame slot,
+//   split the same way
+// * anything larger than half a block gets a dedicated allocation
+class GpuAllocator {
+public:
+
+  static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+  static constexpr vk::DeviceSize MIN_BUDDY_BLOCK_SIZE = 256;
+  static constexpr vk::DeviceSize FRAME_BLOCK_SIZE = 16ull << 20;
+
+  struct Stats {
+    u32 device_allocations{0};
+    u32 max_device_allocations{0};
+
+    // bytes reserved from the driver, across all blocks
+    vk::DeviceSize reserved_bytes{0};
+
+    // bytes callers asked for
+    vk::DeviceSize requested_bytes{0};
+
+    // buddy rounding and alignment padding inside live allocations
+    vk::DeviceSize wasted_bytes{0};
+
+    // 1 - largest free block / free bytes, averaged over pool blocks
+    f64 fragmentation{0.0};
+
+    // high water mark of the frame linear blocks
+    vk::DeviceSize peak_frame_bytes{0};
+  };
+
+  GpuAllocator() = default;
+
+  GpuAllocator(const GpuAllocator&) = delete;
+  GpuAllocator(GpuAllocator&&) = delete;
+  auto operator=(const GpuAllocator&) -> GpuAllocator& = delete;
+  auto operator=(GpuAllocator&&) -> GpuAllocator& = delete;
+  ~GpuAllocator() = default;
+
+  auto init(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    u32 frames_in_flight
+  ) -> void;
+
+  // releases every block, all GpuBuffer / GpuImage must be gone by now
+  auto clear() -> void;
+
+  [[nodiscard]] auto allocate(
+    const vk::MemoryRequirements& requirements,
+    vk::MemoryPropertyFlags properties,
+    ResourceKind kind,
+    AllocationLifetime lifetime = AllocationLifetime::ePersistent
+  ) -> GpuAllocation;
+
+  auto free(const GpuAllocation& allocation) -> void;
+
+  [[nodiscard]] auto create_buffer(
+    const vk::BufferCreateInfo& info,
+    vk::MemoryPropertyFlags properties,
+    AllocationLifetime lifetime = AllocationLifetime::ePersistent
+  ) -> GpuBuffer;
+
+  [[nodiscard]] auto create_image(
+    const vk::ImageCreateInfo& info,
+    vk::MemoryPropertyFlags properties,
+    AllocationLifetime lifetime = AllocationLifetime::ePersistent
+  ) -> GpuImage;
+
+  // recycles the linear blocks of frame_index, the caller guarantees the GPU
+  // is done with the previous frame that used this slot
+  auto begin_frame(u32 frame_index) -> void;
+
+  [[nodiscard]] auto find_memory_type(
+    u32 type_filter,
+    vk::MemoryPropertyFlags properties
+  ) const -> u32;
+
+  [[nodiscard]] auto get_stats() const -> Stats;
+
+  auto log_stats() const -> void;
+
+private:
+
+  struct Block {
+    vk::raii::DeviceMemory memory;
+    void* mapped;
+    BuddyAllocator buddy;
+  };
+
+  struct Pool {
+    u32 memory_type;
+    ResourceKind kind;
+    Vec<std::unique_ptr<Block>> blocks{};
+  };
+
+  static constexpr u32 RESOURCE_KIND_COUNT = 2;
+
+  struct FrameBlock {
+    vk::raii::DeviceMemory memory;
+    void* mapped;
+    LinearAllocator linear;
+  };
+
+  struct FrameArena {
+    // per memory type and resource kind, see get_frame_list, each fills up
+    // before the next one is used
+    Vec<Vec<std::unique_ptr<FrameBlock>>> blocks{};
+    Vec<usize> current{};
+  };
+
+  [[nodiscard]] auto allocate_memory(vk::DeviceSize size, u32 memory_type)
+    -> std::pair<vk::raii::DeviceMemory, void*>;
+
+  [[nodiscard]] auto get_pool(u32 memory_type, ResourceKind kind) -> u32;
+
+  [[nodiscard]] auto allocate_persistent(
+    const vk::MemoryRequirements& requirements,
+    u32 memory_type,
+    ResourceKind kind
+  ) -> GpuAllocation;
+
+  [[nodiscard]] static auto get_frame_list(
+    u32 memory_type,
+    ResourceKind kind
+  ) -> usize;
+
+  [[nodiscard]] auto allocate_frame(
+    const vk::MemoryRequirements& requirements,
+    u32 memory_type,
+    ResourceKind kind
+  ) -> GpuAllocation;
+
+  const vk::raii::Device* device{nullptr};
+  vk::PhysicalDeviceMemoryProperties memory_properties{};
+  vk::DeviceSize block_size{DEFAULT_BLOCK_SIZE};
+  u32 max_allocations{0};
+
+  mutable std::mutex mutex{};
+
+  Vec<Pool> pools{};
+  Vec<FrameArena> frames{};
+  u32 current_frame{0};
+
+  // dedicated allocations, keyed by their handle
+  std::unordered_map<VkDeviceMemory, vk::raii::DeviceMemory> dedicated{};
+
+  u32 device_allocations{0};
+  vk::DeviceSize reserved_bytes{0};
+  vk::DeviceSize requested_bytes{0};
+  vk::DeviceSize wasted_bytes{0};
+  vk::DeviceSize peak_frame_bytes{0};
+};
@@ -0,0 +1,143 @@
+#include "JobSystem.hpp"
+#include <spdlog/spdlog.h>
+
+namespace {
+  thread_local u32 current_thread_index{0};
+}
+
+JobSystem::JobSystem(u32 worker_count) {
+  if (worker_count == 0) {
+    const u32 hardware{std::max(std::thread::hardware_concurrency(), 2u)};
+    worker_count = hardware - 1;
+  }
+
+  for (u32 i = 0; i < worker_count + 1; i++) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+
+  for (u32 i = 1; i < worker_count + 1; i++) {
+    workers.emplace_back([this, i] { worker_main(i); });
+  }
+
+  spdlog::info("Job system: {} worker threads", worker_count);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock{sleep_mutex};
+    stopping = true;
+  }
+  sleep_condition.notify_all();
+
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+}
+
+auto JobSystem::thread_index() -> u32 { return current_thread_index; }
+
+auto JobSystem::submit(Counter& counter, Job job) -> void {
+  counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+  Queue& queue{*queues.at(thread_index())};
+
+  {
+    std::lock_guard lock{queue.mutex};
+    queue.jobs.push_back({.job = std::move(job), .counter = &counter});
+  }
+
+  {
+    // taken so a worker can't miss the wake up between checking queued and
+    // going to sleep
+    std::lock_guard lock{sleep_mutex};
+    queued.fetch_add(1, std::memory_order_release);
+  }
+  sleep_condition.notify_one();
+}
+
+auto JobSystem::wait(Counter& counter) -> void {
+  const u32 self{thread_index()};
+
+  while (not counter.is_done()) {
+    if (not try_run_one(self)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+auto JobSystem::parallel_for(
+  const u32 count,
+  const std::function<void(u32)>& fn
+) -> void {
+  Counter counter{};
+
+  for (u32 i = 0; i < count; i++) {
+    submit(counter, [&fn, i] { fn(i); });
+  }
+
+  wait(counter);
+}
+
+auto JobSystem::worker_main(const u32 index) -> void {
+  current_thread_index = index;
+
+  while (true) {
+    if (try_run_one(index)) {
+      continue;
+    }
+
+    std::unique_lock lock{sleep_mutex};
+    sleep_condition.wait(lock, [this] {
+      return stopping or queued.load(std::memory_order_acquire) > 0;
+    });
+
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+auto JobSystem::try_run_one(const u32 self) -> bool {
+  Option<Entry> entry{};
+
+  // newest work of our own first, it is the most likely to be cache hot
+  {
+    Queue& own{*queues.at(self)};
+    std::lock_guard lock{own.mutex};
+
+    if (not own.jobs.empty()) {
+      entry = std::move(own.jobs.back());
+      own.jobs.pop_back();
+    }
+  }
+
+  // then steal the oldest work of everyone else
+  for (u32 i = 1; entry.is_none() and i < queues.size(); i++) {
+    Queue& victim{*queues.at((self + i) % queues.size())};
+    std::lock_guard lock{victim.mutex};
+
+    if (not victim.jobs.empty()) {
+      entry = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+    }
+  }
+
+  if (entry.is_none()) {
+    return false;
+  }
+
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  run(entry.get_unchecked());
+  return true;
+}
+
+auto JobSystem::run(Entry& entry) -> void {
+  try {
+    entry.job();
+  } catch (const std::exception& e) {
+    // still complete the job, a waiter must never hang on a failed one
+    spdlog::error("Job threw: {}", e.what());
+  }
+
+  entry.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Work stealing job scheduler. Every thread owns a deque, it pushes and pops
+// its own work at the back while idle threads steal from the front of
+// others. Threads that wait on a counter run queued jobs instead of blocking.
+//
+// Thread index 0 is whichever non-worker thread submits (the main thread),
+// workers are 1..thread_count() - 1, so per-thread resources can be indexed
+// by thread_index().
+class JobSystem {
+public:
+
+  using Job = std::function<void()>;
+
+  // tracks completion of a group of jobs
+  class Counter {
+  public:
+
+    [[nodiscard]] auto is_done() const -> bool {
+      return pending.load(std::memory_order_acquire) == 0;
+    }
+
+  private:
+
+    friend class JobSystem;
+    std::atomic<u32> pending{0};
+  };
+
+  // 0 workers sizes the pool to the machine, leaving a core for the caller
+  explicit JobSystem(u32 worker_count = 0);
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem(JobSystem&&) = delete;
+  auto operator=(const JobSystem&) -> JobSystem& = delete;
+  auto operator=(JobSystem&&) -> JobSystem& = delete;
+  ~JobSystem();
+
+  [[nodiscard]] auto thread_count() const -> u32 {
+    return static_cast<u32>(queues.size());
+  }
+
+  [[nodiscard]] static auto thread_index() -> u32;
+
+  auto submit(Counter& counter, Job job) -> void;
+
+  // runs other jobs until every job submitted against counter has finished
+  auto wait(Counter& counter) -> void;
+
+  // runs fn(i) for i in [0, count) across all threads and waits for them
+  auto parallel_for(u32 count, const std::function<void(u32)>& fn) -> void;
+
+private:
+
+  struct Entry {
+    Job job;
+    Counter* counter;
+  };
+
+  struct Queue {
+    std::mutex mutex{};
+    std::deque<Entry> jobs{};
+  };
+
+  auto worker_main(u32 index) -> void;
+
+  [[nodiscard]] auto try_run_one(u32 self) -> bool;
+
+  static auto run(Entry& entry) -> void;
+
+  Vec<std::unique_ptr<Queue>> queues{};
+  Vec<std::thread> workers{};
+
+  std::mutex sleep_mutex{};
+  std::condition_variable sleep_condition{};
+  std::atomic<u32> queued{0};
+  std::atomic<bool> stopping{false};
+};
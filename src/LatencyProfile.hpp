@@ -0,0 +1,97 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <vulkan/vulkan.hpp>
+
+// Trade-offs between throughput, input latency and power, each one a preset
+// for how much work may be queued between input and the screen.
+enum class LatencyProfile {
+  // render as fast as possible, deep queues keep the GPU fed
+  eMaxThroughput,
+
+  // shallow queues and a frame pacer that samples input as late as it can
+  eLowLatency,
+
+  // vsync with as little queued as possible
+  ePowerSaving,
+};
+
+struct LatencySettings {
+  // in order of preference, FIFO is always available as the fallback
+  Span<const vk::PresentModeKHR> present_modes;
+
+  // requested swapchain images, clamped to what the surface supports
+  u32 image_count;
+
+  u32 frames_in_flight;
+
+  // delay input sampling so recording finishes just before it is needed
+  bool pace_frames;
+};
+
+namespace latency_profile {
+  inline constexpr std::array MAX_THROUGHPUT_MODES{
+    vk::PresentModeKHR::eMailbox,
+    vk::PresentModeKHR::eImmediate,
+  };
+
+  inline constexpr std::array LOW_LATENCY_MODES{
+    vk::PresentModeKHR::eMailbox,
+  };
+
+  [[nodiscard]] constexpr auto get_settings(const LatencyProfile profile)
+    -> LatencySettings {
+    switch (profile) {
+      case LatencyProfile::eMaxThroughput:
+        return {
+          .present_modes = MAX_THROUGHPUT_MODES,
+          .image_count = 3,
+          .frames_in_flight = 3,
+          .pace_frames = false,
+        };
+      case LatencyProfile::eLowLatency:
+        return {
+          .present_modes = LOW_LATENCY_MODES,
+          .image_count = 3,
+          .frames_in_flight = 1,
+          .pace_frames = true,
+        };
+      case LatencyProfile::ePowerSaving:
+        return {
+          .present_modes = {},
+          .image_count = 2,
+          .frames_in_flight = 1,
+          .pace_frames = false,
+        };
+    }
+
+    return get_settings(LatencyProfile::eMaxThroughput);
+  }
+
+  [[nodiscard]] constexpr auto get_name(const LatencyProfile profile)
+    -> StringView {
+    switch (profile) {
+      case LatencyProfile::eMaxThroughput: return "max-throughput";
+      case LatencyProfile::eLowLatency: return "low-latency";
+      case LatencyProfile::ePowerSaving: return "power-saving";
+    }
+
+    return "unknown";
+  }
+
+  [[nodiscard]] inline auto parse(const StringView name)
+    -> Option<LatencyProfile> {
+    for (const LatencyProfile profile: {
+           LatencyProfile::eMaxThroughput,
+           LatencyProfile::eLowLatency,
+           LatencyProfile::ePowerSaving,
+         }) {
+      if (get_name(profile) == name) {
+        return profile;
+      }
+    }
+
+    return crab::none;
+  }
+}
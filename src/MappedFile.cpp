@@ -0,0 +1,191 @@
+#include "MappedFile.hpp"
+#include <fmt/format.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept:
+    data{std::exchange(other.data, nullptr)},
+    size{std::exchange(other.size, 0)},
+    path{std::move(other.path)}
+#ifdef _WIN32
+    ,
+    mapping{std::exchange(other.mapping, nullptr)}
+#endif
+{
+}
+
+auto MappedFile::operator=(MappedFile&& other) noexcept -> MappedFile& {
+  if (this == &other) {
+    return *this;
+  }
+
+  unmap();
+
+  data = std::exchange(other.data, nullptr);
+  size = std::exchange(other.size, 0);
+  path = std::move(other.path);
+#ifdef _WIN32
+  mapping = std::exchange(other.mapping, nullptr);
+#endif
+
+  return *this;
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+auto MappedFile::words() const -> Span<const u32> {
+  if (size % sizeof(u32) != 0) {
+    throw std::runtime_error{fmt::format(
+      "'{}' is {} bytes, which is not a whole number of 32 bit words",
+      path.string(),
+      size
+    )};
+  }
+
+  return {
+    reinterpret_cast<const u32*>(data), // NOLINT
+    size / sizeof(u32),
+  };
+}
+
+#ifdef _WIN32
+
+auto MappedFile::open(const std::filesystem::path& path) -> MappedFile {
+  MappedFile file{};
+  file.path = path;
+
+  HANDLE handle{CreateFileW(
+    path.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr
+  )};
+
+  if (handle == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error{
+      fmt::format("Failed to open file '{}'", path.string())
+    };
+  }
+
+  LARGE_INTEGER file_size{};
+  GetFileSizeEx(handle, &file_size);
+  file.size = static_cast<usize>(file_size.QuadPart);
+
+  if (file.size == 0) {
+    CloseHandle(handle);
+    return file;
+  }
+
+  file.mapping =
+    CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  // the mapping keeps the file alive on its own
+  CloseHandle(handle);
+
+  if (file.mapping == nullptr) {
+    throw std::runtime_error{
+      fmt::format("Failed to map file '{}'", path.string())
+    };
+  }
+
+  file.data = static_cast<const u8*>(
+    MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0)
+  );
+
+  if (file.data == nullptr) {
+    throw std::runtime_error{
+      fmt::format("Failed to map file '{}'", path.string())
+    };
+  }
+
+  return file;
+}
+
+auto MappedFile::unmap() -> void {
+  if (data != nullptr) {
+    UnmapViewOfFile(data);
+  }
+
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+  }
+
+  data = nullptr;
+  mapping = nullptr;
+  size = 0;
+}
+
+#else
+
+auto MappedFile::open(const std::filesystem::path& path) -> MappedFile {
+  MappedFile file{};
+  file.path = path;
+
+  const i32 fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)}; // NOLINT
+
+  if (fd < 0) {
+    throw std::runtime_error{
+      fmt::format("Failed to open file '{}'", path.string())
+    };
+  }
+
+  struct stat info {};
+
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error{
+      fmt::format("Failed to stat file '{}'", path.string())
+    };
+  }
+
+  file.size = static_cast<usize>(info.st_size);
+
+  // mmap rejects zero length mappings
+  if (file.size == 0) {
+    close(fd);
+    return file;
+  }
+
+  void* mapped{mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0)};
+
+  // the mapping keeps the file alive on its own
+  close(fd);
+
+  if (mapped == MAP_FAILED) { // NOLINT
+    file.size = 0;
+    throw std::runtime_error{
+      fmt::format("Failed to map file '{}'", path.string())
+    };
+  }
+
+  // assets are consumed front to back straight after loading
+  posix_madvise(mapped, file.size, POSIX_MADV_WILLNEED);
+
+  file.data = static_cast<const u8*>(mapped);
+  return file;
+}
+
+auto MappedFile::unmap() -> void {
+  if (data != nullptr) {
+    munmap(const_cast<u8*>(data), size); // NOLINT
+  }
+
+  data = nullptr;
+  size = 0;
+}
+
+#endif
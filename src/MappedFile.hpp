@@ -0,0 +1,45 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <filesystem>
+
+// Read-only memory mapped view of a file. Mappings are page aligned, so the
+// contents can be reinterpreted as 32 bit words (eg. SPIR-V) without a copy.
+class MappedFile {
+public:
+
+  MappedFile() = default;
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  auto operator=(const MappedFile&) -> MappedFile& = delete;
+  auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+  ~MappedFile();
+
+  // throws if the file does not exist or cannot be mapped
+  [[nodiscard]] static auto open(const std::filesystem::path& path)
+    -> MappedFile;
+
+  [[nodiscard]] auto bytes() const -> Span<const u8> { return {data, size}; }
+
+  // throws if the file size is not a multiple of 4
+  [[nodiscard]] auto words() const -> Span<const u32>;
+
+  [[nodiscard]] auto get_path() const -> const std::filesystem::path& {
+    return path;
+  }
+
+  [[nodiscard]] auto is_empty() const -> bool { return size == 0; }
+
+private:
+
+  auto unmap() -> void;
+
+  const u8* data{nullptr};
+  usize size{0};
+  std::filesystem::path path{};
+
+#ifdef _WIN32
+  void* mapping{nullptr};
+#endif
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+#include <cstddef>
+#include "GpuAllocator.hpp"
+
+struct Vertex {
+  glm::vec2 position;
+  glm::vec3 color;
+
+  static constexpr vk::VertexInputBindingDescription BINDING{
+    .binding = 0,
+    .stride = sizeof(glm::vec2) + sizeof(glm::vec3),
+    .inputRate = vk::VertexInputRate::eVertex,
+  };
+
+  // matches the locations of VertexInput in triangle.slang
+  static constexpr std::array ATTRIBUTES{
+    vk::VertexInputAttributeDescription{
+      .location = 0,
+      .binding = 0,
+      .format = vk::Format::eR32G32Sfloat,
+      .offset = 0,
+    },
+    vk::VertexInputAttributeDescription{
+      .location = 1,
+      .binding = 0,
+      .format = vk::Format::eR32G32B32Sfloat,
+      .offset = sizeof(glm::vec2),
+    },
+  };
+};
+
+static_assert(sizeof(Vertex) == Vertex::BINDING.stride);
+static_assert(offsetof(Vertex, color) == Vertex::ATTRIBUTES[1].offset);
+
+// per object data, fed as instance rate vertex attributes so each draw picks
+// its object through firstInstance
+struct InstanceData {
+  glm::vec2 offset;
+  f32 scale;
+
+  static constexpr vk::VertexInputBindingDescription BINDING{
+    .binding = 1,
+    .stride = sizeof(glm::vec2) + sizeof(f32),
+    .inputRate = vk::VertexInputRate::eInstance,
+  };
+
+  static constexpr std::array ATTRIBUTES{
+    vk::VertexInputAttributeDescription{
+      .location = 2,
+      .binding = 1,
+      .format = vk::Format::eR32G32Sfloat,
+      .offset = 0,
+    },
+    vk::VertexInputAttributeDescription{
+      .location = 3,
+      .binding = 1,
+      .format = vk::Format::eR32Sfloat,
+      .offset = sizeof(glm::vec2),
+    },
+  };
+};
+
+static_assert(sizeof(InstanceData) == InstanceData::BINDING.stride);
+static_assert(
+  offsetof(InstanceData, scale) == InstanceData::ATTRIBUTES[1].offset
+);
+
+using Index = u16;
+static constexpr vk::IndexType INDEX_TYPE = vk::IndexType::eUint16;
+
+struct Mesh {
+  GpuBuffer vertex_buffer{};
+  GpuBuffer index_buffer{};
+  u32 index_count{0};
+
+  // distance of the furthest vertex from the origin, for culling
+  f32 bounds_radius{0.0f};
+};
@@ -0,0 +1,86 @@
+#include "ParallelRecorder.hpp"
+
+auto ParallelRecorder::init(
+  const vk::raii::Device& device,
+  JobSystem& jobs,
+  const u32 queue_family,
+  const u32 frames_in_flight
+) -> void {
+  this->device = &device;
+  this->jobs = &jobs;
+
+  frames.clear();
+  frames.resize(frames_in_flight);
+
+  for (Vec<ThreadPool>& threads: frames) {
+    threads.resize(jobs.thread_count());
+
+    for (ThreadPool& thread_pool: threads) {
+      // pools are reset as a whole, never per command buffer
+      thread_pool.pool = vk::raii::CommandPool{
+        device,
+        vk::CommandPoolCreateInfo{
+          .flags = vk::CommandPoolCreateFlagBits::eTransient,
+          .queueFamilyIndex = queue_family,
+        },
+      };
+    }
+  }
+}
+
+auto ParallelRecorder::clear() -> void { frames.clear(); }
+
+auto ParallelRecorder::begin_frame(const u32 frame_index) -> void {
+  for (ThreadPool& thread_pool: frames.at(frame_index)) {
+    thread_pool.pool.reset();
+    thread_pool.used = 0;
+  }
+}
+
+auto ParallelRecorder::record(
+  const u32 frame_index,
+  const u32 slice_count,
+  const vk::CommandBufferInheritanceInfo& inheritance,
+  const RecordFn& fn
+) -> Vec<vk::CommandBuffer> {
+  Vec<ThreadPool>& threads{frames.at(frame_index)};
+
+  Vec<vk::CommandBuffer> recorded(slice_count);
+
+  jobs->parallel_for(slice_count, [&](const u32 slice) {
+    ThreadPool& thread_pool{threads.at(JobSystem::thread_index())};
+    const vk::raii::CommandBuffer& cmd{next_buffer(thread_pool)};
+
+    cmd.begin({
+      .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue
+             | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+      .pInheritanceInfo = &inheritance,
+    });
+
+    fn(cmd, slice);
+
+    cmd.end();
+
+    recorded.at(slice) = cmd;
+  });
+
+  return recorded;
+}
+
+auto ParallelRecorder::next_buffer(ThreadPool& thread_pool)
+  -> const vk::raii::CommandBuffer& {
+  if (thread_pool.used == thread_pool.buffers.size()) {
+    vk::raii::CommandBuffers allocated{
+      *device,
+      vk::CommandBufferAllocateInfo{
+        .commandPool = thread_pool.pool,
+        .level = vk::CommandBufferLevel::eSecondary,
+        .commandBufferCount = 1,
+      },
+    };
+
+    thread_pool.buffers.push_back(std::move(allocated.front()));
+  }
+
+  return thread_pool.buffers.at(thread_pool.used++);
+}
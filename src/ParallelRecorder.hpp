@@ -0,0 +1,59 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <functional>
+#include "JobSystem.hpp"
+
+// Records secondary command buffers for slices of a frame across the job
+// system. Every (frame in flight, thread) pair owns its own command pool, so
+// recording never contends on a pool and a frame's pools are reset wholesale.
+class ParallelRecorder {
+public:
+
+  using RecordFn =
+    std::function<void(const vk::raii::CommandBuffer& cmd, u32 slice)>;
+
+  auto init(
+    const vk::raii::Device& device,
+    JobSystem& jobs,
+    u32 queue_family,
+    u32 frames_in_flight
+  ) -> void;
+
+  auto clear() -> void;
+
+  // resets every pool of frame_index, the GPU must be done with its
+  // previous use
+  auto begin_frame(u32 frame_index) -> void;
+
+  // records fn for every slice into its own secondary command buffer and
+  // returns them in slice order. May be called any number of times between
+  // two begin_frame() calls, the buffers stay valid until the next one.
+  [[nodiscard]] auto record(
+    u32 frame_index,
+    u32 slice_count,
+    const vk::CommandBufferInheritanceInfo& inheritance,
+    const RecordFn& fn
+  ) -> Vec<vk::CommandBuffer>;
+
+private:
+
+  struct ThreadPool {
+    vk::raii::CommandPool pool{nullptr};
+
+    // grows to the most slices this thread has recorded in one frame
+    Vec<vk::raii::CommandBuffer> buffers{};
+    usize used{0};
+  };
+
+  [[nodiscard]] auto next_buffer(ThreadPool& thread_pool)
+    -> const vk::raii::CommandBuffer&;
+
+  const vk::raii::Device* device{nullptr};
+  JobSystem* jobs{nullptr};
+
+  // [frame in flight][thread index]
+  Vec<Vec<ThreadPool>> frames{};
+};
@@ -0,0 +1,148 @@
+#include "ParticleSystem.hpp"
+#include <spdlog/spdlog.h>
+#include "Mesh.hpp"
+
+namespace {
+  // matches Particle in particles.slang
+  struct Particle {
+    f32 position[2];
+    f32 velocity[2];
+  };
+}
+
+auto ParticleSystem::init(
+  const vk::raii::Device& device,
+  GpuAllocator& allocator,
+  PipelineCache& pipeline_cache,
+  BindlessHeap& heap,
+  const Span<const u32> spirv,
+  const Config& config
+) -> void {
+  this->heap = &heap;
+  particle_count = std::max(config.particle_count, 1u);
+
+  spdlog::info("Creating particle system for {} particles", particle_count);
+
+  const vk::raii::ShaderModule module{
+    device,
+    vk::ShaderModuleCreateInfo{
+      .codeSize = spirv.size_bytes(),
+      .pCode = spirv.data(),
+    },
+  };
+
+  pipeline = pipeline_cache.create_compute_pipeline({
+    .stage = {
+      .stage = vk::ShaderStageFlagBits::eCompute,
+      .module = module,
+      .pName = "simulateMain",
+    },
+    .layout = heap.get_pipeline_layout(),
+  });
+
+  particle_buffer = allocator.create_buffer(
+    {
+      .size = particle_count * sizeof(Particle),
+      .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eDeviceLocal
+  );
+  particle_slot = heap.add_storage_buffer(particle_buffer.get());
+
+  // written on the compute queue and read on the graphics one, concurrent
+  // sharing spares an ownership transfer each way every frame
+  const std::array families{config.graphics_family, config.compute_family};
+  const bool shared{config.graphics_family != config.compute_family};
+
+  for (u32 i = 0; i < OUTPUT_COUNT; i++) {
+    instance_buffers.at(i) = allocator.create_buffer(
+      {
+        .size = particle_count * sizeof(InstanceData),
+        .usage = vk::BufferUsageFlagBits::eStorageBuffer
+               | vk::BufferUsageFlagBits::eVertexBuffer,
+        .sharingMode = shared ? vk::SharingMode::eConcurrent
+                              : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = shared ? 2u : 0u,
+        .pQueueFamilyIndices = shared ? families.data() : nullptr,
+      },
+      vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+    instance_slots.at(i) =
+      heap.add_storage_buffer(instance_buffers.at(i).get());
+  }
+
+  initialized = false;
+}
+
+auto ParticleSystem::clear() -> void {
+  if (heap != nullptr) {
+    using enum BindlessHeap::Kind;
+    heap->release(eStorageBuffer, particle_slot, 0);
+
+    for (const u32 slot: instance_slots) {
+      heap->release(eStorageBuffer, slot, 0);
+    }
+
+    heap = nullptr;
+  }
+
+  for (GpuBuffer& buffer: instance_buffers) {
+    buffer.reset();
+  }
+
+  particle_buffer.reset();
+  pipeline.clear();
+}
+
+auto ParticleSystem::record_simulate(
+  const vk::raii::CommandBuffer& cmd,
+  const u64 timeline_value
+) -> void {
+  const Clock::time_point now{Clock::now()};
+  const std::chrono::duration<f32> elapsed{now - last_step};
+  last_step = now;
+
+  current_output = static_cast<u32>(timeline_value % OUTPUT_COUNT);
+
+  const PushConstants push_constants{
+    .particle_count = particle_count,
+    .delta_time = initialized ? std::min(elapsed.count(), MAX_DELTA_TIME)
+                              : 0.0f,
+    .initialize = initialized ? 0u : 1u,
+    .particles = particle_slot,
+    .instances = instance_slots.at(current_output),
+  };
+
+  initialized = true;
+
+  // the previous step wrote the particles in an earlier submission on this
+  // queue
+  const vk::MemoryBarrier2 stepped{
+    .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+    .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+    .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead
+                   | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+
+  cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &stepped}
+  );
+
+  cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+  heap->bind(cmd, vk::PipelineBindPoint::eCompute);
+  heap->push_constants(cmd, push_constants);
+  cmd.dispatch((particle_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+auto ParticleSystem::record_draw(
+  const vk::raii::CommandBuffer& cmd,
+  const u32 index_count
+) const -> void {
+  cmd.bindVertexBuffers(
+    InstanceData::BINDING.binding,
+    {*instance_buffers.at(current_output).get()},
+    {0}
+  );
+  cmd.drawIndexed(index_count, particle_count, 0, 0, 0);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <chrono>
+#include "BindlessHeap.hpp"
+#include "GpuAllocator.hpp"
+#include "PipelineCache.hpp"
+
+// Particles simulated by a compute shader on the async compute queue and
+// drawn as instances of the scene's mesh.
+//
+// The simulation writes each frame's instances into one of OUTPUT_COUNT
+// buffers, so frame N's dispatch only has to wait for the draws of frame
+// N - OUTPUT_COUNT and runs alongside the rasterization of frame N - 1. The
+// frame's graphics submission waits on the compute timeline before it reads
+// them as vertex input. Particle state never leaves the compute queue.
+class ParticleSystem {
+public:
+
+  // numthreads of simulateMain in particles.slang
+  static constexpr u32 WORKGROUP_SIZE = 64;
+
+  static constexpr u32 OUTPUT_COUNT = 2;
+
+  // longest step the simulation takes, so a stall does not fling particles
+  // out of the view
+  static constexpr f32 MAX_DELTA_TIME = 1.0f / 30.0f;
+
+  struct Config {
+    u32 particle_count;
+
+    // the instance buffers are shared between these two when they differ
+    u32 graphics_family;
+    u32 compute_family;
+  };
+
+  // registers its buffers with heap and builds on its pipeline layout
+  auto init(
+    const vk::raii::Device& device,
+    GpuAllocator& allocator,
+    PipelineCache& pipeline_cache,
+    BindlessHeap& heap,
+    Span<const u32> spirv,
+    const Config& config
+  ) -> void;
+
+  // the device must be idle, the heap slots are free again right away
+  auto clear() -> void;
+
+  [[nodiscard]] auto is_enabled() const -> bool { return heap != nullptr; }
+
+  // steps every particle into the instances of the frame that signals
+  // timeline_value, on a compute queue command buffer
+  auto record_simulate(const vk::raii::CommandBuffer& cmd, u64 timeline_value)
+    -> void;
+
+  // draws the last simulated instances, the graphics pipeline and the mesh's
+  // vertex / index buffers must already be bound
+  auto record_draw(const vk::raii::CommandBuffer& cmd, u32 index_count) const
+    -> void;
+
+private:
+
+  using Clock = std::chrono::steady_clock;
+
+  // matches ParticleConstants in particles.slang
+  struct PushConstants {
+    u32 particle_count;
+    f32 delta_time;
+
+    // seeds every particle instead of stepping it
+    u32 initialize;
+
+    // heap slots of the storage buffers
+    u32 particles;
+    u32 instances;
+  };
+
+  BindlessHeap* heap{nullptr};
+  vk::raii::Pipeline pipeline{nullptr};
+
+  // position and velocity of every particle, compute queue only
+  GpuBuffer particle_buffer{};
+  u32 particle_slot{0};
+
+  // InstanceData per particle, vertex input of the scene pipeline
+  std::array<GpuBuffer, OUTPUT_COUNT> instance_buffers{};
+  std::array<u32, OUTPUT_COUNT> instance_slots{};
+
+  u32 particle_count{0};
+
+  // the output record_draw reads, set by record_simulate
+  u32 current_output{0};
+
+  bool initialized{false};
+  Clock::time_point last_step{};
+};
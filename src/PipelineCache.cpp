@@ -0,0 +1,347 @@
+#include "PipelineCache.hpp"
+#include <spdlog/spdlog.h>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+auto PipelineCache::open(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physical_device,
+  std::filesystem::path path
+) -> void {
+  this->device = &device;
+  this->properties = physical_device.getProperties();
+  this->path = std::move(path);
+
+  MappedFile file{};
+
+  if (std::filesystem::exists(this->path)) {
+    file = MappedFile::open(this->path);
+  } else {
+    spdlog::info(
+      "No pipeline cache at '{}', starting cold",
+      this->path.string()
+    );
+  }
+
+  // the driver copies what it needs, so the mapping only has to outlive the
+  // create call
+  const Span<const u8> blob{validate(file)};
+
+  const vk::PipelineCacheCreateInfo create_info{
+    .initialDataSize = blob.size(),
+    .pInitialData = blob.empty() ? nullptr : blob.data(),
+  };
+
+  cache = vk::raii::PipelineCache{device, create_info};
+}
+
+auto PipelineCache::clear() -> void {
+  wait_for_write();
+  cache.clear();
+  device = nullptr;
+}
+
+auto PipelineCache::validate(const MappedFile& file) -> Span<const u8> {
+  const Span<const u8> bytes{file.bytes()};
+
+  if (bytes.empty()) {
+    return {};
+  }
+
+  if (bytes.size() < sizeof(FileHeader)) {
+    spdlog::warn("Pipeline cache '{}' is truncated, ignoring", path.string());
+    return {};
+  }
+
+  FileHeader header{};
+  std::memcpy(&header, bytes.data(), sizeof(FileHeader));
+
+  const FileHeader expected{make_header()};
+
+  const bool same_device = header.magic == MAGIC
+                       and header.file_version == FILE_VERSION
+                       and header.vendor_id == expected.vendor_id
+                       and header.device_id == expected.device_id
+                       and header.driver_version == expected.driver_version
+                       and header.pipeline_cache_uuid
+                             == expected.pipeline_cache_uuid;
+
+  if (not same_device) {
+    spdlog::info(
+      "Pipeline cache '{}' was written by another device or driver, ignoring",
+      path.string()
+    );
+    return {};
+  }
+
+  if (header.data_size != bytes.size() - sizeof(FileHeader)) {
+    spdlog::warn("Pipeline cache '{}' has a bad size, ignoring", path.string());
+    return {};
+  }
+
+  const Span<const u8> blob{bytes.subspan(sizeof(FileHeader))};
+
+  if (checksum(blob) != header.data_checksum) {
+    spdlog::warn("Pipeline cache '{}' is corrupt, ignoring", path.string());
+    return {};
+  }
+
+  // the driver validates this as well, but a mismatch here is a cheaper and
+  // clearer rejection than relying on every implementation to do so
+  vk::PipelineCacheHeaderVersionOne vk_header{};
+  if (blob.size() < sizeof(vk_header)) {
+    return {};
+  }
+
+  std::memcpy(&vk_header, blob.data(), sizeof(vk_header));
+
+  if (vk_header.headerVersion != vk::PipelineCacheHeaderVersion::eOne
+      or vk_header.vendorID != properties.vendorID
+      or vk_header.deviceID != properties.deviceID
+      or vk_header.pipelineCacheUUID != properties.pipelineCacheUUID) {
+    spdlog::info(
+      "Pipeline cache '{}' header mismatch, ignoring",
+      path.string()
+    );
+    return {};
+  }
+
+  previous_average_miss_ns = header.average_miss_ns;
+
+  spdlog::info(
+    "Loaded pipeline cache '{}' ({} bytes)",
+    path.string(),
+    blob.size()
+  );
+
+  return blob;
+}
+
+auto PipelineCache::make_header() const -> FileHeader {
+  FileHeader header{
+    .magic = MAGIC,
+    .file_version = FILE_VERSION,
+    .vendor_id = properties.vendorID,
+    .device_id = properties.deviceID,
+    .driver_version = properties.driverVersion,
+    .pipeline_cache_uuid = {},
+    .data_size = 0,
+    .data_checksum = 0,
+    .average_miss_ns = 0,
+  };
+
+  ranges::copy(
+    properties.pipelineCacheUUID,
+    header.pipeline_cache_uuid.begin()
+  );
+
+  return header;
+}
+
+template<typename CreateInfo>
+auto PipelineCache::create_pipeline(CreateInfo info) -> vk::raii::Pipeline {
+  vk::PipelineCreationFeedback feedback{};
+
+  const vk::PipelineCreationFeedbackCreateInfo feedback_info{
+    .pNext = info.pNext,
+    .pPipelineCreationFeedback = &feedback,
+  };
+  info.pNext = &feedback_info;
+
+  const Clock::time_point start{Clock::now()};
+  vk::raii::Pipeline pipeline{*device, cache, info};
+  const Clock::time_point end{Clock::now()};
+
+  record(
+    feedback,
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+  );
+
+  return pipeline;
+}
+
+auto PipelineCache::create_graphics_pipeline(
+  const vk::GraphicsPipelineCreateInfo info
+) -> vk::raii::Pipeline {
+  return create_pipeline(info);
+}
+
+auto PipelineCache::create_compute_pipeline(
+  const vk::ComputePipelineCreateInfo info
+) -> vk::raii::Pipeline {
+  return create_pipeline(info);
+}
+
+auto PipelineCache::record(
+  const vk::PipelineCreationFeedback& feedback,
+  const u64 wall_ns
+) -> void {
+  const bool valid{
+    feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid
+  };
+
+  // drivers that do not fill in feedback are counted as misses, so the
+  // reported hit rate is never optimistic
+  const bool hit{
+    valid
+    and (feedback.flags
+         & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit)
+  };
+
+  const u64 duration_ns = valid ? feedback.duration : wall_ns;
+
+  std::lock_guard lock{mutex};
+
+  if (not hit) {
+    stats.misses++;
+    stats.miss_ns += duration_ns;
+    dirty = true;
+    return;
+  }
+
+  stats.hits++;
+  stats.hit_ns += duration_ns;
+
+  const u64 average_miss_ns =
+    stats.misses != 0 ? stats.miss_ns / stats.misses : previous_average_miss_ns;
+
+  if (average_miss_ns > duration_ns) {
+    stats.saved_ns += average_miss_ns - duration_ns;
+  }
+}
+
+auto PipelineCache::take_snapshot() -> Snapshot {
+  Snapshot snapshot{.header = make_header(), .blob = cache.getData()};
+  snapshot.header.data_size = snapshot.blob.size();
+
+  std::lock_guard lock{mutex};
+  last_save = Clock::now();
+  dirty = false;
+  snapshot.header.average_miss_ns = stats.misses != 0
+                                    ? stats.miss_ns / stats.misses
+                                    : previous_average_miss_ns;
+
+  return snapshot;
+}
+
+auto PipelineCache::write(
+  const std::filesystem::path& path,
+  Snapshot snapshot
+) -> void {
+  snapshot.header.data_checksum = checksum(snapshot.blob);
+
+  // write next to the destination and rename over it, so a crash mid-write
+  // never leaves a half written cache behind
+  std::filesystem::path temp_path{path};
+  temp_path += ".tmp";
+
+  {
+    std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+
+    if (not file.is_open()) {
+      spdlog::warn("Failed to open '{}' for writing", temp_path.string());
+      return;
+    }
+
+    file.write(
+      reinterpret_cast<const char*>(&snapshot.header), // NOLINT
+      sizeof(FileHeader)
+    );
+    file.write(
+      reinterpret_cast<const char*>(snapshot.blob.data()), // NOLINT
+      static_cast<ptrdiff>(snapshot.blob.size())
+    );
+
+    if (not file) {
+      spdlog::warn("Failed to write pipeline cache '{}'", temp_path.string());
+      return;
+    }
+  }
+
+  std::error_code error{};
+  std::filesystem::rename(temp_path, path, error);
+
+  if (error) {
+    spdlog::warn(
+      "Failed to replace pipeline cache '{}': {}",
+      path.string(),
+      error.message()
+    );
+    return;
+  }
+
+  spdlog::info(
+    "Saved pipeline cache '{}' ({} bytes)",
+    path.string(),
+    snapshot.blob.size()
+  );
+}
+
+auto PipelineCache::wait_for_write() -> void {
+  if (writing.valid()) {
+    writing.get();
+  }
+}
+
+auto PipelineCache::save() -> void {
+  wait_for_write();
+
+  if (cache == nullptr) {
+    return;
+  }
+
+  write(path, take_snapshot());
+}
+
+auto PipelineCache::save_if_due() -> void {
+  {
+    std::lock_guard lock{mutex};
+
+    if (not dirty or Clock::now() - last_save < SAVE_INTERVAL) {
+      return;
+    }
+  }
+
+  // the previous write is still going, try again next frame
+  if (writing.valid()
+      and writing.wait_for(std::chrono::seconds{0})
+            != std::future_status::ready) {
+    return;
+  }
+
+  wait_for_write();
+  writing = std::async(
+    std::launch::async,
+    [destination = path, snapshot = take_snapshot()]() mutable {
+      write(destination, std::move(snapshot));
+    }
+  );
+}
+
+auto PipelineCache::log_stats() const -> void {
+  constexpr f64 NS_PER_MS = 1'000'000.0;
+
+  const Stats snapshot{get_stats()};
+
+  spdlog::info(
+    "Pipeline cache: {} hits ({:.2f}ms), {} misses ({:.2f}ms), ~{:.2f}ms saved",
+    snapshot.hits,
+    static_cast<f64>(snapshot.hit_ns) / NS_PER_MS,
+    snapshot.misses,
+    static_cast<f64>(snapshot.miss_ns) / NS_PER_MS,
+    static_cast<f64>(snapshot.saved_ns) / NS_PER_MS
+  );
+}
+
+auto PipelineCache::checksum(const Span<const u8> data) -> u64 {
+  // FNV-1a, only guards against truncated / corrupted files
+  u64 hash = 0xcbf29ce484222325;
+
+  for (const u8 byte: data) {
+    hash ^= byte;
+    hash *= 0x100000001b3;
+  }
+
+  return hash;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include "MappedFile.hpp"
+
+// VkPipelineCache that is persisted to disk between runs. The blob is
+// prefixed with our own header so a cache produced by a different device or
+// driver is discarded instead of being handed to the driver.
+//
+// Pipelines may be created through it from any thread.
+class PipelineCache {
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr u32 MAGIC = 0x4350564c; // "LVPC"
+  static constexpr u32 FILE_VERSION = 1;
+  static constexpr Clock::duration SAVE_INTERVAL = std::chrono::seconds{30};
+
+  struct Stats {
+    u32 hits{0};
+    u32 misses{0};
+    u64 hit_ns{0};
+    u64 miss_ns{0};
+
+    // creation time saved by hits, estimated from the average miss time
+    u64 saved_ns{0};
+  };
+
+  // creates the VkPipelineCache, seeded from the file at path if it exists
+  // and was written by this device + driver
+  auto open(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    std::filesystem::path path
+  ) -> void;
+
+  // destroys the VkPipelineCache, must happen before the device is destroyed
+  auto clear() -> void;
+
+  [[nodiscard]] auto create_graphics_pipeline(
+    vk::GraphicsPipelineCreateInfo info
+  ) -> vk::raii::Pipeline;
+
+  [[nodiscard]] auto create_compute_pipeline(
+    vk::ComputePipelineCreateInfo info
+  ) -> vk::raii::Pipeline;
+
+  // writes the cache back to disk, atomically replacing the previous file,
+  // once any save still in progress is done
+  auto save() -> void;
+
+  // saves only if new pipelines were compiled and SAVE_INTERVAL has passed.
+  // Only the blob is read here, it is checksummed and written out on a
+  // thread of its own so the caller never waits on the disk
+  auto save_if_due() -> void;
+
+  auto log_stats() const -> void;
+
+  [[nodiscard]] auto get_stats() const -> Stats {
+    std::lock_guard lock{mutex};
+    return stats;
+  }
+
+  [[nodiscard]] auto get() const -> const vk::raii::PipelineCache& {
+    return cache;
+  }
+
+private:
+
+  struct FileHeader {
+    u32 magic;
+    u32 file_version;
+    u32 vendor_id;
+    u32 device_id;
+    u32 driver_version;
+    std::array<u8, vk::UuidSize> pipeline_cache_uuid;
+    u64 data_size;
+    u64 data_checksum;
+
+    // average miss time of the run that wrote the file, used to estimate
+    // time saved when every pipeline hits
+    u64 average_miss_ns;
+  };
+
+  // returns the validated driver blob inside file, or an empty span
+  [[nodiscard]] auto validate(const MappedFile& file) -> Span<const u8>;
+
+  [[nodiscard]] auto make_header() const -> FileHeader;
+
+  // the cache as it is now, header filled in up to the checksum
+  struct Snapshot {
+    FileHeader header;
+    Vec<u8> blob;
+  };
+
+  [[nodiscard]] auto take_snapshot() -> Snapshot;
+
+  static auto write(const std::filesystem::path& path, Snapshot snapshot)
+    -> void;
+
+  auto wait_for_write() -> void;
+
+  // creates the pipeline through the cache with creation feedback chained
+  // onto info, and records the outcome
+  template<typename CreateInfo>
+  [[nodiscard]] auto create_pipeline(CreateInfo info) -> vk::raii::Pipeline;
+
+  auto record(const vk::PipelineCreationFeedback& feedback, u64 wall_ns)
+    -> void;
+
+  [[nodiscard]] static auto checksum(Span<const u8> data) -> u64;
+
+  const vk::raii::Device* device{nullptr};
+  vk::PhysicalDeviceProperties properties{};
+  std::filesystem::path path{};
+  vk::raii::PipelineCache cache{nullptr};
+
+  // VkPipelineCache is internally synchronised, this only guards the
+  // bookkeeping below
+  mutable std::mutex mutex{};
+
+  Stats stats{};
+  u64 previous_average_miss_ns{0};
+  bool dirty{false};
+  Clock::time_point last_save{Clock::now()};
+
+  // the background write save_if_due started, if any
+  std::future<void> writing{};
+};
@@ -0,0 +1,448 @@
+#include "PipelineVariants.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <chrono>
+#include "Mesh.hpp"
+
+struct PipelineVariants::Shaders {
+  vk::raii::ShaderModule module{nullptr};
+
+  // only with the pipeline library, every part but the fragment shader
+  vk::raii::Pipeline vertex_input{nullptr};
+  vk::raii::Pipeline pre_rasterization{nullptr};
+  vk::raii::Pipeline fragment_output{nullptr};
+
+  vk::raii::Pipeline generic{nullptr};
+
+  // null while the variant is queued or compiling, under
+  // PipelineVariants::mutex
+  std::map<Key, vk::raii::Pipeline> variants{};
+};
+
+namespace {
+  constexpr std::array DYNAMIC_STATES{
+    vk::DynamicState::eViewport,
+    vk::DynamicState::eScissor,
+  };
+
+  constexpr std::array VERTEX_BINDINGS{
+    Vertex::BINDING,
+    InstanceData::BINDING,
+  };
+
+  constexpr std::array VERTEX_ATTRIBUTES{
+    Vertex::ATTRIBUTES[0],
+    Vertex::ATTRIBUTES[1],
+    InstanceData::ATTRIBUTES[0],
+    InstanceData::ATTRIBUTES[1],
+  };
+
+  constexpr vk::PipelineColorBlendAttachmentState COLOR_BLEND_ATTACHMENT{
+    .blendEnable = vk::False,
+    .colorWriteMask = vk::ColorComponentFlagBits::eR
+                    | vk::ColorComponentFlagBits::eG
+                    | vk::ColorComponentFlagBits::eB
+                    | vk::ColorComponentFlagBits::eA,
+  };
+
+  // specialisation constants of triangle.slang, by constant_id
+  struct SpecializationData {
+    vk::Bool32 specialized;
+    u32 color_mode;
+  };
+
+  constexpr std::array SPECIALIZATION_ENTRIES{
+    vk::SpecializationMapEntry{
+      .constantID = 0,
+      .offset = offsetof(SpecializationData, specialized),
+      .size = sizeof(vk::Bool32),
+    },
+    vk::SpecializationMapEntry{
+      .constantID = 1,
+      .offset = offsetof(SpecializationData, color_mode),
+      .size = sizeof(u32),
+    },
+  };
+
+  // everything but the shader stages, create infos point into it so it never
+  // moves
+  struct FixedState {
+    explicit FixedState(const vk::Format& color_format):
+        rendering{
+          .colorAttachmentCount = 1,
+          .pColorAttachmentFormats = &color_format,
+        } {}
+
+    FixedState(const FixedState&) = delete;
+    FixedState(FixedState&&) = delete;
+    auto operator=(const FixedState&) -> FixedState& = delete;
+    auto operator=(FixedState&&) -> FixedState& = delete;
+    ~FixedState() = default;
+
+    const vk::PipelineDynamicStateCreateInfo dynamic_state{
+      .dynamicStateCount = static_cast<u32>(DYNAMIC_STATES.size()),
+      .pDynamicStates = DYNAMIC_STATES.data(),
+    };
+
+    const vk::PipelineVertexInputStateCreateInfo vertex_input{
+      .vertexBindingDescriptionCount = VERTEX_BINDINGS.size(),
+      .pVertexBindingDescriptions = VERTEX_BINDINGS.data(),
+      .vertexAttributeDescriptionCount = VERTEX_ATTRIBUTES.size(),
+      .pVertexAttributeDescriptions = VERTEX_ATTRIBUTES.data(),
+    };
+
+    const vk::PipelineInputAssemblyStateCreateInfo input_assembly{
+      .topology = vk::PrimitiveTopology::eTriangleList,
+    };
+
+    // both are dynamic, so the pipeline never depends on the swapchain extent
+    const vk::PipelineViewportStateCreateInfo viewport{
+      .viewportCount = 1,
+      .scissorCount = 1,
+    };
+
+    const vk::PipelineRasterizationStateCreateInfo rasterization{
+      .depthClampEnable = vk::False,
+      .rasterizerDiscardEnable = vk::False,
+      .polygonMode = vk::PolygonMode::eFill,
+      .cullMode = vk::CullModeFlagBits::eBack,
+      .frontFace = vk::FrontFace::eClockwise,
+      .depthBiasEnable = vk::False,
+      .depthBiasSlopeFactor = 1.0f,
+      .lineWidth = 1.0f,
+    };
+
+    const vk::PipelineMultisampleStateCreateInfo multisample{
+      .rasterizationSamples = vk::SampleCountFlagBits::e1,
+      .sampleShadingEnable = vk::False,
+    };
+
+    const vk::PipelineColorBlendStateCreateInfo color_blend{
+      .attachmentCount = 1,
+      .pAttachments = &COLOR_BLEND_ATTACHMENT,
+    };
+
+    const vk::PipelineRenderingCreateInfo rendering;
+  };
+
+  // the generic pipeline leaves every constant at its default, so it reads
+  // the variant from DrawConstants instead
+  struct Specialization {
+    explicit Specialization(const Option<PipelineVariants::Key>& key) {
+      if (key.is_none()) {
+        return;
+      }
+
+      data = {
+        .specialized = vk::True,
+        .color_mode = key.get_unchecked().color_mode,
+      };
+
+      info = vk::SpecializationInfo{
+        .mapEntryCount = static_cast<u32>(SPECIALIZATION_ENTRIES.size()),
+        .pMapEntries = SPECIALIZATION_ENTRIES.data(),
+        .dataSize = sizeof(SpecializationData),
+        .pData = &data,
+      };
+    }
+
+    Specialization(const Specialization&) = delete;
+    Specialization(Specialization&&) = delete;
+    auto operator=(const Specialization&) -> Specialization& = delete;
+    auto operator=(Specialization&&) -> Specialization& = delete;
+    ~Specialization() = default;
+
+    [[nodiscard]] auto get() const -> const vk::SpecializationInfo* {
+      return data.specialized ? &info : nullptr;
+    }
+
+    SpecializationData data{};
+    vk::SpecializationInfo info{};
+  };
+
+  [[nodiscard]] auto get_name(const Option<PipelineVariants::Key>& key)
+    -> String {
+    if (key.is_none()) {
+      return "generic";
+    }
+
+    return fmt::format("color_mode={}", key.get_unchecked().color_mode);
+  }
+}
+
+PipelineVariants::~PipelineVariants() { clear(); }
+
+auto PipelineVariants::init(
+  const vk::raii::Device& device,
+  PipelineCache& pipeline_cache,
+  const Config& config
+) -> void {
+  this->device = &device;
+  this->pipeline_cache = &pipeline_cache;
+  this->config = config;
+
+  spdlog::info(
+    "Pipeline variants compile on {} thread(s){}",
+    config.compile_threads,
+    config.use_library ? " through pipeline libraries" : ""
+  );
+
+  stopping = false;
+
+  for (u32 i = 0; i < std::max(config.compile_threads, 1u); i++) {
+    threads.emplace_back([this] { compile_main(); });
+  }
+}
+
+auto PipelineVariants::clear() -> void {
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+    queue.clear();
+  }
+  wake.notify_all();
+
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+
+  threads.clear();
+  current.reset();
+  device = nullptr;
+  pipeline_cache = nullptr;
+}
+
+auto PipelineVariants::build(const Span<const u32> spirv)
+  -> std::shared_ptr<Shaders> {
+  auto shaders = std::make_shared<Shaders>();
+
+  shaders->module = vk::raii::ShaderModule{
+    *device,
+    vk::ShaderModuleCreateInfo{
+      .codeSize = spirv.size_bytes(),
+      .pCode = spirv.data(),
+    },
+  };
+
+  if (config.use_library) {
+    build_libraries(*shaders);
+  }
+
+  shaders->generic = build_variant(*shaders, crab::none);
+  return shaders;
+}
+
+auto PipelineVariants::swap(std::shared_ptr<Shaders> shaders)
+  -> std::shared_ptr<Shaders> {
+  std::lock_guard lock{mutex};
+
+  // variants of the old shaders are of no use anymore
+  std::erase_if(queue, [&](const Request& request) {
+    return request.shaders == current;
+  });
+
+  std::swap(current, shaders);
+  return shaders;
+}
+
+auto PipelineVariants::get(const Key& key) -> vk::Pipeline {
+  std::lock_guard lock{mutex};
+
+  auto [found, inserted] = current->variants.try_emplace(key, nullptr);
+
+  if (inserted) {
+    queue.push_back({.shaders = current, .key = key});
+    wake.notify_one();
+  }
+
+  if (found->second != nullptr) {
+    return *found->second;
+  }
+
+  return *current->generic;
+}
+
+auto PipelineVariants::compile_main() -> void {
+  while (true) {
+    Request request{};
+
+    {
+      std::unique_lock lock{mutex};
+      wake.wait(lock, [this] { return stopping or not queue.empty(); });
+
+      if (stopping) {
+        return;
+      }
+
+      request = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    vk::raii::Pipeline pipeline{build_variant(*request.shaders, request.key)};
+    const std::chrono::duration<f64, std::milli> elapsed{
+      std::chrono::steady_clock::now() - start
+    };
+
+    spdlog::info(
+      "Compiled pipeline variant {} in {:.1f}ms",
+      get_name(request.key),
+      elapsed.count()
+    );
+
+    std::lock_guard lock{mutex};
+    request.shaders->variants.at(request.key) = std::move(pipeline);
+  }
+}
+
+auto PipelineVariants::build_variant(
+  const Shaders& shaders,
+  const Option<Key>& key
+) -> vk::raii::Pipeline {
+  if (config.use_library) {
+    return build_linked(shaders, key);
+  }
+
+  return build_monolithic(shaders, key);
+}
+
+auto PipelineVariants::build_monolithic(
+  const Shaders& shaders,
+  const Option<Key>& key
+) -> vk::raii::Pipeline {
+  const FixedState state{config.color_format};
+  const Specialization specialization{key};
+
+  const std::array stages{
+    vk::PipelineShaderStageCreateInfo{
+      .stage = vk::ShaderStageFlagBits::eVertex,
+      .module = shaders.module,
+      .pName = "vertMain",
+    },
+    vk::PipelineShaderStageCreateInfo{
+      .stage = vk::ShaderStageFlagBits::eFragment,
+      .module = shaders.module,
+      .pName = "fragMain",
+      .pSpecializationInfo = specialization.get(),
+    },
+  };
+
+  return pipeline_cache->create_graphics_pipeline({
+    .pNext = &state.rendering,
+    .stageCount = static_cast<u32>(stages.size()),
+    .pStages = stages.data(),
+    .pVertexInputState = &state.vertex_input,
+    .pInputAssemblyState = &state.input_assembly,
+    .pViewportState = &state.viewport,
+    .pRasterizationState = &state.rasterization,
+    .pMultisampleState = &state.multisample,
+    .pColorBlendState = &state.color_blend,
+    .pDynamicState = &state.dynamic_state,
+    .layout = config.layout,
+  });
+}
+
+auto PipelineVariants::build_libraries(Shaders& shaders) -> void {
+  const FixedState state{config.color_format};
+
+  const auto create_library = [&](
+                                const vk::GraphicsPipelineLibraryFlagsEXT part,
+                                vk::GraphicsPipelineCreateInfo info
+                              ) {
+    const vk::GraphicsPipelineLibraryCreateInfoEXT library_info{
+      .pNext = &state.rendering,
+      .flags = part,
+    };
+
+    info.pNext = &library_info;
+    info.flags |= vk::PipelineCreateFlagBits::eLibraryKHR;
+    return pipeline_cache->create_graphics_pipeline(info);
+  };
+
+  using enum vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+  shaders.vertex_input = create_library(
+    eVertexInputInterface,
+    {
+      .pVertexInputState = &state.vertex_input,
+      .pInputAssemblyState = &state.input_assembly,
+    }
+  );
+
+  const vk::PipelineShaderStageCreateInfo vertex_stage{
+    .stage = vk::ShaderStageFlagBits::eVertex,
+    .module = shaders.module,
+    .pName = "vertMain",
+  };
+
+  shaders.pre_rasterization = create_library(
+    ePreRasterizationShaders,
+    {
+      .stageCount = 1,
+      .pStages = &vertex_stage,
+      .pViewportState = &state.viewport,
+      .pRasterizationState = &state.rasterization,
+      .pDynamicState = &state.dynamic_state,
+      .layout = config.layout,
+    }
+  );
+
+  shaders.fragment_output = create_library(
+    eFragmentOutputInterface,
+    {
+      .pMultisampleState = &state.multisample,
+      .pColorBlendState = &state.color_blend,
+    }
+  );
+}
+
+auto PipelineVariants::build_linked(
+  const Shaders& shaders,
+  const Option<Key>& key
+) -> vk::raii::Pipeline {
+  const FixedState state{config.color_format};
+  const Specialization specialization{key};
+
+  const vk::PipelineShaderStageCreateInfo fragment_stage{
+    .stage = vk::ShaderStageFlagBits::eFragment,
+    .module = shaders.module,
+    .pName = "fragMain",
+    .pSpecializationInfo = specialization.get(),
+  };
+
+  const vk::GraphicsPipelineLibraryCreateInfoEXT library_info{
+    .pNext = &state.rendering,
+    .flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+  };
+
+  // the only part that differs between variants
+  const vk::raii::Pipeline fragment_shader{
+    pipeline_cache->create_graphics_pipeline({
+      .pNext = &library_info,
+      .flags = vk::PipelineCreateFlagBits::eLibraryKHR,
+      .stageCount = 1,
+      .pStages = &fragment_stage,
+      .pMultisampleState = &state.multisample,
+      .layout = config.layout,
+    })
+  };
+
+  const std::array libraries{
+    *shaders.vertex_input,
+    *shaders.pre_rasterization,
+    *fragment_shader,
+    *shaders.fragment_output,
+  };
+
+  const vk::PipelineLibraryCreateInfoKHR link_info{
+    .libraryCount = static_cast<u32>(libraries.size()),
+    .pLibraries = libraries.data(),
+  };
+
+  // no link time optimisation, linking is then about as cheap as a lookup
+  // and the linked pipeline no longer needs the fragment shader library
+  return pipeline_cache->create_graphics_pipeline({
+    .pNext = &link_info,
+    .layout = config.layout,
+  });
+}
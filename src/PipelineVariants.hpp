@@ -0,0 +1,130 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "PipelineCache.hpp"
+
+// The graphics pipeline and its specialised variants.
+//
+// Every set of shaders gets a generic pipeline up front, which reads the
+// variant from DrawConstants at run time. A variant specialises those
+// choices into constants instead, and is compiled on a background thread
+// the first time it is asked for, the generic one is drawn with until then
+// so asking never stalls a frame.
+//
+// With VK_EXT_graphics_pipeline_library everything but the fragment shader
+// is compiled once per set of shaders, so a variant is one fragment shader
+// library plus a fast link. Without it, every variant is a full pipeline.
+class PipelineVariants {
+public:
+
+  // matches ColorMode in triangle.slang
+  static constexpr u32 COLOR_MODE_COUNT = 3;
+
+  // matches the specialisation constants and DrawConstants in triangle.slang
+  struct Key {
+    u32 color_mode{0};
+
+    auto operator<=>(const Key&) const = default;
+  };
+
+  // matches DrawConstants in triangle.slang, read from the UniformRing
+  struct DrawConstants {
+    u32 color_mode;
+  };
+
+  struct Config {
+    vk::PipelineLayout layout;
+    vk::Format color_format;
+
+    // VK_EXT_graphics_pipeline_library is enabled on the device
+    bool use_library;
+
+    u32 compile_threads{1};
+  };
+
+  // one set of shaders and everything compiled from them
+  struct Shaders;
+
+  PipelineVariants() = default;
+
+  PipelineVariants(const PipelineVariants&) = delete;
+  PipelineVariants(PipelineVariants&&) = delete;
+  auto operator=(const PipelineVariants&) -> PipelineVariants& = delete;
+  auto operator=(PipelineVariants&&) -> PipelineVariants& = delete;
+  ~PipelineVariants();
+
+  auto init(
+    const vk::raii::Device& device,
+    PipelineCache& pipeline_cache,
+    const Config& config
+  ) -> void;
+
+  // stops the compile threads and drops every pipeline, the device must be
+  // idle
+  auto clear() -> void;
+
+  // compiles the generic pipeline for spirv, safe from any thread
+  [[nodiscard]] auto build(Span<const u32> spirv) -> std::shared_ptr<Shaders>;
+
+  // makes shaders the ones get() draws with and returns the previous ones,
+  // which frames in flight may still be using
+  auto swap(std::shared_ptr<Shaders> shaders) -> std::shared_ptr<Shaders>;
+
+  // the variant for key if it is compiled, the generic pipeline otherwise,
+  // in which case the variant is queued
+  [[nodiscard]] auto get(const Key& key) -> vk::Pipeline;
+
+  // what the generic pipeline reads instead of the constants of key
+  [[nodiscard]] static auto get_draw_constants(const Key& key)
+    -> DrawConstants {
+    return {.color_mode = key.color_mode};
+  }
+
+private:
+
+  struct Request {
+    std::shared_ptr<Shaders> shaders;
+    Key key;
+  };
+
+  auto compile_main() -> void;
+
+  [[nodiscard]] auto build_variant(
+    const Shaders& shaders,
+    const Option<Key>& key
+  ) -> vk::raii::Pipeline;
+
+  [[nodiscard]] auto build_monolithic(
+    const Shaders& shaders,
+    const Option<Key>& key
+  ) -> vk::raii::Pipeline;
+
+  auto build_libraries(Shaders& shaders) -> void;
+
+  [[nodiscard]] auto build_linked(
+    const Shaders& shaders,
+    const Option<Key>& key
+  ) -> vk::raii::Pipeline;
+
+  const vk::raii::Device* device{nullptr};
+  PipelineCache* pipeline_cache{nullptr};
+  Config config{};
+
+  std::shared_ptr<Shaders> current{};
+
+  // guards current's variants and the queue
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  std::deque<Request> queue{};
+  bool stopping{false};
+  Vec<std::thread> threads{};
+};
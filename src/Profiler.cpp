@@ -0,0 +1,344 @@
+#include "Profiler.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <fstream>
+
+Profiler::CpuScope::CpuScope(Profiler& profiler, const StringView name):
+    profiler{profiler}, name{name}, start{Clock::now()} {}
+
+Profiler::CpuScope::~CpuScope() { profiler.end_cpu_scope(name, start); }
+
+Profiler::GpuScope::GpuScope(
+  Profiler& profiler,
+  const vk::raii::CommandBuffer& cmd,
+  const StringView name
+):
+    profiler{profiler}, cmd{cmd},
+    scope{profiler.begin_gpu_scope(cmd, name)} {}
+
+Profiler::GpuScope::~GpuScope() {
+  if (scope.is_some()) {
+    profiler.end_gpu_scope(cmd, scope.get_unchecked());
+  }
+}
+
+Profiler::Profiler(): start{Clock::now()} {}
+
+auto Profiler::init_gpu(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physical_device,
+  const u32 queue_family,
+  const u32 frames_in_flight
+) -> void {
+  const u32 valid_bits{
+    physical_device.getQueueFamilyProperties().at(queue_family)
+      .timestampValidBits
+  };
+
+  if (valid_bits == 0) {
+    spdlog::warn(
+      "Queue family {} has no timestamps, GPU scopes are off",
+      queue_family
+    );
+    return;
+  }
+
+  timestamp_period_ns =
+    physical_device.getProperties().limits.timestampPeriod;
+  timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+  gpu_frames.clear();
+  gpu_frames.resize(frames_in_flight);
+
+  for (GpuFrame& frame: gpu_frames) {
+    frame.pool = vk::raii::QueryPool{
+      device,
+      vk::QueryPoolCreateInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = MAX_GPU_SCOPES * 2,
+      },
+    };
+  }
+}
+
+auto Profiler::clear() -> void {
+  current_gpu_frame = nullptr;
+  gpu_frames.clear();
+}
+
+auto Profiler::begin_gpu_frame(
+  const vk::raii::CommandBuffer& cmd,
+  const u32 frame_index
+) -> void {
+  if (gpu_frames.empty()) {
+    return;
+  }
+
+  GpuFrame& frame{gpu_frames.at(frame_index)};
+  collect(frame);
+
+  cmd.resetQueryPool(frame.pool, 0, MAX_GPU_SCOPES * 2);
+  frame.recorded = Clock::now();
+  current_gpu_frame = &frame;
+}
+
+auto Profiler::collect_all() -> void {
+  for (GpuFrame& frame: gpu_frames) {
+    collect(frame);
+  }
+}
+
+auto Profiler::collect(GpuFrame& frame) -> void {
+  if (frame.names.empty()) {
+    return;
+  }
+
+  const auto query_count = static_cast<u32>(frame.names.size() * 2);
+
+  // the frame has retired, so the results are there without waiting
+  auto [result, ticks] = frame.pool.getResults<u64>(
+    0,
+    query_count,
+    query_count * sizeof(u64),
+    sizeof(u64),
+    vk::QueryResultFlagBits::e64
+  );
+
+  Vec<StringView> names{std::move(frame.names)};
+  frame.names.clear();
+
+  if (result != vk::Result::eSuccess) {
+    return;
+  }
+
+  std::lock_guard lock{mutex};
+
+  if (gpu_origin_ticks.is_none()) {
+    gpu_origin_ticks = ticks.front() & timestamp_mask;
+    gpu_origin_us = to_us(frame.recorded);
+  }
+
+  const u64 origin{gpu_origin_ticks.get_unchecked()};
+
+  for (usize i = 0; i < names.size(); i++) {
+    const u64 begin{ticks.at(i * 2) & timestamp_mask};
+    const u64 end{ticks.at(i * 2 + 1) & timestamp_mask};
+
+    const f64 duration_ns{
+      static_cast<f64>((end - begin) & timestamp_mask) * timestamp_period_ns
+    };
+
+    push_sample(gpu_history[names[i]], duration_ns / 1e6);
+
+    if (not tracing or events.size() >= MAX_TRACE_EVENTS) {
+      continue;
+    }
+
+    const f64 since_origin_ns{
+      static_cast<f64>((begin - origin) & timestamp_mask) * timestamp_period_ns
+    };
+
+    events.push_back({
+      .name = names[i],
+      .thread = 0,
+      .gpu = true,
+      .start_us = gpu_origin_us + since_origin_ns / 1e3,
+      .duration_us = duration_ns / 1e3,
+    });
+  }
+}
+
+auto Profiler::begin_gpu_scope(
+  const vk::raii::CommandBuffer& cmd,
+  const StringView name
+) -> Option<u32> {
+  if (current_gpu_frame == nullptr
+      or current_gpu_frame->names.size() == MAX_GPU_SCOPES) {
+    return crab::none;
+  }
+
+  const auto scope = static_cast<u32>(current_gpu_frame->names.size());
+  current_gpu_frame->names.push_back(name);
+
+  // both ends wait for everything before them, so a scope measures the time
+  // its commands took to drain rather than when they were first picked up
+  cmd.writeTimestamp2(
+    vk::PipelineStageFlagBits2::eAllCommands,
+    current_gpu_frame->pool,
+    scope * 2
+  );
+
+  return scope;
+}
+
+auto Profiler::end_gpu_scope(
+  const vk::raii::CommandBuffer& cmd,
+  const u32 scope
+) -> void {
+  cmd.writeTimestamp2(
+    vk::PipelineStageFlagBits2::eAllCommands,
+    current_gpu_frame->pool,
+    scope * 2 + 1
+  );
+}
+
+auto Profiler::end_cpu_scope(
+  const StringView name,
+  const Clock::time_point start
+) -> void {
+  const Clock::time_point end{Clock::now()};
+  const std::chrono::duration<f64, std::milli> elapsed{end - start};
+
+  std::lock_guard lock{mutex};
+
+  push_sample(cpu_history[name], elapsed.count());
+
+  if (not tracing or events.size() >= MAX_TRACE_EVENTS) {
+    return;
+  }
+
+  events.push_back({
+    .name = name,
+    .thread = thread_id(),
+    .gpu = false,
+    .start_us = to_us(start),
+    .duration_us = elapsed.count() * 1e3,
+  });
+}
+
+auto Profiler::thread_id() -> u32 {
+  const std::thread::id id{std::this_thread::get_id()};
+  const auto found = ranges::find(threads, id);
+
+  if (found != threads.end()) {
+    return static_cast<u32>(found - threads.begin());
+  }
+
+  threads.push_back(id);
+  return static_cast<u32>(threads.size() - 1);
+}
+
+auto Profiler::to_us(const Clock::time_point time) const -> f64 {
+  return std::chrono::duration<f64, std::micro>{time - start}.count();
+}
+
+auto Profiler::push_sample(History& history, const f64 ms) const -> void {
+  if (history.samples_ms.size() < history_size) {
+    history.samples_ms.push_back(ms);
+  } else {
+    history.samples_ms.at(history.count % history_size) = ms;
+  }
+
+  history.count++;
+}
+
+auto Profiler::percentiles(const History& history) -> Percentiles {
+  Vec<f64> sorted{history.samples_ms};
+  ranges::sort(sorted);
+
+  const usize size{sorted.size()};
+
+  const auto at = [&](const f64 percentile) {
+    const auto index = static_cast<usize>(
+      percentile * static_cast<f64>(size - 1) + 0.5
+    );
+    return sorted.at(index);
+  };
+
+  return {
+    .p50_ms = at(0.50),
+    .p95_ms = at(0.95),
+    .p99_ms = at(0.99),
+    .max_ms = sorted.at(size - 1),
+    .samples = size,
+  };
+}
+
+auto Profiler::get_cpu_percentiles(const StringView name) const
+  -> Option<Percentiles> {
+  std::lock_guard lock{mutex};
+  const auto found = cpu_history.find(name);
+
+  if (found == cpu_history.end()) {
+    return crab::none;
+  }
+
+  return percentiles(found->second);
+}
+
+auto Profiler::get_gpu_percentiles(const StringView name) const
+  -> Option<Percentiles> {
+  std::lock_guard lock{mutex};
+  const auto found = gpu_history.find(name);
+
+  if (found == gpu_history.end()) {
+    return crab::none;
+  }
+
+  return percentiles(found->second);
+}
+
+auto Profiler::log_stats() const -> void {
+  std::lock_guard lock{mutex};
+
+  const auto log = [](const char* kind, const auto& histories) {
+    for (const auto& [name, history]: histories) {
+      const Percentiles stats{percentiles(history)};
+
+      spdlog::info(
+        "{} {:<24} p50 {:8.3f}ms  p95 {:8.3f}ms  p99 {:8.3f}ms  "
+        "max {:8.3f}ms  ({} samples)",
+        kind,
+        name,
+        stats.p50_ms,
+        stats.p95_ms,
+        stats.p99_ms,
+        stats.max_ms,
+        stats.samples
+      );
+    }
+  };
+
+  log("CPU", cpu_history);
+  log("GPU", gpu_history);
+}
+
+auto Profiler::write_trace(const std::filesystem::path& path) const -> void {
+  std::lock_guard lock{mutex};
+
+  std::ofstream file{path, std::ios::trunc};
+
+  if (not file.is_open()) {
+    spdlog::warn("Failed to open '{}' for writing", path.string());
+    return;
+  }
+
+  // pid 1 is the CPU with a track per thread, pid 2 is the graphics queue
+  file << fmt::format(
+    "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+    "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+    "\"args\":{{\"name\":\"CPU\"}}}},\n"
+    "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,"
+    "\"args\":{{\"name\":\"GPU\"}}}}"
+  );
+
+  for (const TraceEvent& event: events) {
+    file << fmt::format(
+      ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},"
+      "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+      event.name,
+      event.gpu ? 2 : 1,
+      event.thread,
+      event.start_us,
+      event.duration_us
+    );
+  }
+
+  file << "\n]}\n";
+
+  spdlog::info(
+    "Wrote {} trace events to '{}'",
+    events.size(),
+    path.string()
+  );
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// CPU and GPU timing scopes.
+//
+// GPU scopes write timestamps into a query pool per frame in flight. A
+// pool is read back when its frame slot comes around again, once the frame
+// timeline says the GPU is done with it, so reading never stalls.
+//
+// Every scope feeds a rolling window of durations for percentile stats, and
+// with tracing on is also kept as an event for Chrome / Perfetto trace JSON.
+//
+// Scope names must outlive the profiler, in practice they are literals.
+class Profiler {
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  // timestamp pairs per frame, scopes past this are dropped
+  static constexpr u32 MAX_GPU_SCOPES = 64;
+
+  // default number of durations kept per scope for the percentiles
+  static constexpr usize HISTORY_SIZE = 512;
+
+  // stops tracing rather than grow without bound on long runs
+  static constexpr usize MAX_TRACE_EVENTS = 1 << 20;
+
+  struct Percentiles {
+    f64 p50_ms;
+    f64 p95_ms;
+    f64 p99_ms;
+    f64 max_ms;
+    usize samples;
+  };
+
+  class CpuScope {
+  public:
+
+    CpuScope(Profiler& profiler, StringView name);
+
+    CpuScope(const CpuScope&) = delete;
+    CpuScope(CpuScope&&) = delete;
+    auto operator=(const CpuScope&) -> CpuScope& = delete;
+    auto operator=(CpuScope&&) -> CpuScope& = delete;
+    ~CpuScope();
+
+  private:
+
+    Profiler& profiler;
+    StringView name;
+    Clock::time_point start;
+  };
+
+  class GpuScope {
+  public:
+
+    GpuScope(
+      Profiler& profiler,
+      const vk::raii::CommandBuffer& cmd,
+      StringView name
+    );
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope(GpuScope&&) = delete;
+    auto operator=(const GpuScope&) -> GpuScope& = delete;
+    auto operator=(GpuScope&&) -> GpuScope& = delete;
+    ~GpuScope();
+
+  private:
+
+    Profiler& profiler;
+    const vk::raii::CommandBuffer& cmd;
+    Option<u32> scope;
+  };
+
+  Profiler();
+
+  // GPU scopes are no-ops until this is called, and stay that way if the
+  // queue family cannot write timestamps
+  auto init_gpu(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    u32 queue_family,
+    u32 frames_in_flight
+  ) -> void;
+
+  // destroys the query pools, must happen before the device is destroyed
+  auto clear() -> void;
+
+  auto set_tracing(bool enabled) -> void { tracing = enabled; }
+
+  // call before any scope is sampled
+  auto set_history_size(usize size) -> void {
+    history_size = std::max<usize>(size, 1);
+  }
+
+  // reads back the last use of frame_index and records the reset of its
+  // pool, the GPU must be done with that frame
+  auto begin_gpu_frame(const vk::raii::CommandBuffer& cmd, u32 frame_index)
+    -> void;
+
+  // reads back every frame slot, for after the device went idle
+  auto collect_all() -> void;
+
+  [[nodiscard]] auto get_cpu_percentiles(StringView name) const
+    -> Option<Percentiles>;
+
+  [[nodiscard]] auto get_gpu_percentiles(StringView name) const
+    -> Option<Percentiles>;
+
+  auto log_stats() const -> void;
+
+  auto write_trace(const std::filesystem::path& path) const -> void;
+
+private:
+
+  struct History {
+    Vec<f64> samples_ms{};
+    usize count{0};
+  };
+
+  struct TraceEvent {
+    StringView name;
+    u32 thread;
+    bool gpu;
+    f64 start_us;
+    f64 duration_us;
+  };
+
+  struct GpuFrame {
+    vk::raii::QueryPool pool{nullptr};
+    Vec<StringView> names{};
+
+    // CPU time the frame was recorded, anchors the GPU clock for tracing
+    Clock::time_point recorded{};
+  };
+
+  auto end_cpu_scope(StringView name, Clock::time_point start) -> void;
+
+  [[nodiscard]] auto begin_gpu_scope(
+    const vk::raii::CommandBuffer& cmd,
+    StringView name
+  ) -> Option<u32>;
+
+  auto end_gpu_scope(const vk::raii::CommandBuffer& cmd, u32 scope) -> void;
+
+  auto collect(GpuFrame& frame) -> void;
+
+  [[nodiscard]] auto thread_id() -> u32;
+
+  [[nodiscard]] auto to_us(Clock::time_point time) const -> f64;
+
+  auto push_sample(History& history, f64 ms) const -> void;
+
+  [[nodiscard]] static auto percentiles(const History& history)
+    -> Percentiles;
+
+  Clock::time_point start{};
+  bool tracing{false};
+  usize history_size{HISTORY_SIZE};
+
+  Vec<GpuFrame> gpu_frames{};
+  GpuFrame* current_gpu_frame{nullptr};
+  f64 timestamp_period_ns{0.0};
+  u64 timestamp_mask{0};
+
+  // first GPU timestamp read back and the CPU time it is pinned to, the GPU
+  // track in traces is only approximately lined up with the CPU ones
+  Option<u64> gpu_origin_ticks{};
+  f64 gpu_origin_us{0.0};
+
+  mutable std::mutex mutex{};
+  std::map<StringView, History> cpu_history{};
+  std::map<StringView, History> gpu_history{};
+  Vec<TraceEvent> events{};
+  Vec<std::thread::id> threads{};
+};
@@ -0,0 +1,183 @@
+#include "Queues.hpp"
+
+auto QueueFamilies::find(const vk::raii::PhysicalDevice& device)
+  -> Option<QueueFamilies> {
+  const Vec<vk::QueueFamilyProperties> properties{
+    device.getQueueFamilyProperties()
+  };
+
+  constexpr vk::QueueFlags GRAPHICS{vk::QueueFlagBits::eGraphics};
+  constexpr vk::QueueFlags COMPUTE{vk::QueueFlagBits::eCompute};
+  constexpr vk::QueueFlags TRANSFER{vk::QueueFlagBits::eTransfer};
+
+  Option<u32> graphics{};
+  QueueFamilies families{};
+
+  for (u32 i = 0; i < properties.size(); i++) {
+    const vk::QueueFlags flags{properties.at(i).queueFlags};
+
+    if (graphics.is_none() and (flags & GRAPHICS)) {
+      graphics = i;
+      continue;
+    }
+
+    if (families.compute.is_none() and (flags & COMPUTE)
+        and not(flags & GRAPHICS)) {
+      families.compute = i;
+      continue;
+    }
+
+    // graphics and compute queues implicitly support transfers, only a
+    // family without either is a dedicated copy engine
+    if (families.transfer.is_none() and (flags & TRANSFER)
+        and not(flags & (GRAPHICS | COMPUTE))) {
+      families.transfer = i;
+    }
+  }
+
+  if (graphics.is_none()) {
+    return crab::none;
+  }
+
+  families.graphics = graphics.get_unchecked();
+  return families;
+}
+
+auto QueueFamilies::queue_create_infos() const
+  -> Vec<vk::DeviceQueueCreateInfo> {
+  Vec<vk::DeviceQueueCreateInfo> infos{
+    {
+      .queueFamilyIndex = graphics,
+      .queueCount = 1,
+      .pQueuePriorities = &GRAPHICS_PRIORITY,
+    },
+  };
+
+  if (compute.is_some()) {
+    infos.push_back({
+      .queueFamilyIndex = compute.get_unchecked(),
+      .queueCount = 1,
+      .pQueuePriorities = &COMPUTE_PRIORITY,
+    });
+  }
+
+  if (transfer.is_some()) {
+    infos.push_back({
+      .queueFamilyIndex = transfer.get_unchecked(),
+      .queueCount = 1,
+      .pQueuePriorities = &TRANSFER_PRIORITY,
+    });
+  }
+
+  return infos;
+}
+
+namespace queue_ownership {
+  auto release(
+    const vk::Buffer buffer,
+    const u32 src_family,
+    const u32 dst_family,
+    const vk::PipelineStageFlags2 src_stage,
+    const vk::AccessFlags2 src_access
+  ) -> vk::BufferMemoryBarrier2 {
+    // the destination half of a release is ignored
+    return {
+      .srcStageMask = src_stage,
+      .srcAccessMask = src_access,
+      .dstStageMask = vk::PipelineStageFlagBits2::eNone,
+      .dstAccessMask = vk::AccessFlagBits2::eNone,
+      .srcQueueFamilyIndex = src_family,
+      .dstQueueFamilyIndex = dst_family,
+      .buffer = buffer,
+      .offset = 0,
+      .size = vk::WholeSize,
+    };
+  }
+
+  auto acquire(
+    const vk::Buffer buffer,
+    const u32 src_family,
+    const u32 dst_family,
+    const vk::PipelineStageFlags2 dst_stage,
+    const vk::AccessFlags2 dst_access
+  ) -> vk::BufferMemoryBarrier2 {
+    // the source half of an acquire is ignored, the semaphore wait orders it
+    return {
+      .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask = dst_stage,
+      .dstAccessMask = dst_access,
+      .srcQueueFamilyIndex = src_family,
+      .dstQueueFamilyIndex = dst_family,
+      .buffer = buffer,
+      .offset = 0,
+      .size = vk::WholeSize,
+    };
+  }
+
+  auto release(
+    const vk::Image image,
+    const vk::ImageSubresourceRange range,
+    const vk::ImageLayout old_layout,
+    const vk::ImageLayout new_layout,
+    const u32 src_family,
+    const u32 dst_family,
+    const vk::PipelineStageFlags2 src_stage,
+    const vk::AccessFlags2 src_access
+  ) -> vk::ImageMemoryBarrier2 {
+    return {
+      .srcStageMask = src_stage,
+      .srcAccessMask = src_access,
+      .dstStageMask = vk::PipelineStageFlagBits2::eNone,
+      .dstAccessMask = vk::AccessFlagBits2::eNone,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = src_family,
+      .dstQueueFamilyIndex = dst_family,
+      .image = image,
+      .subresourceRange = range,
+    };
+  }
+
+  auto acquire(
+    const vk::Image image,
+    const vk::ImageSubresourceRange range,
+    const vk::ImageLayout old_layout,
+    const vk::ImageLayout new_layout,
+    const u32 src_family,
+    const u32 dst_family,
+    const vk::PipelineStageFlags2 dst_stage,
+    const vk::AccessFlags2 dst_access
+  ) -> vk::ImageMemoryBarrier2 {
+    // layouts must match the release exactly
+    return {
+      .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+      .srcAccessMask = vk::AccessFlagBits2::eNone,
+      .dstStageMask = dst_stage,
+      .dstAccessMask = dst_access,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = src_family,
+      .dstQueueFamilyIndex = dst_family,
+      .image = image,
+      .subresourceRange = range,
+    };
+  }
+
+  auto record(
+    const vk::raii::CommandBuffer& cmd,
+    const Span<const vk::BufferMemoryBarrier2> buffers,
+    const Span<const vk::ImageMemoryBarrier2> images
+  ) -> void {
+    if (buffers.empty() and images.empty()) {
+      return;
+    }
+
+    cmd.pipelineBarrier2({
+      .bufferMemoryBarrierCount = static_cast<u32>(buffers.size()),
+      .pBufferMemoryBarriers = buffers.data(),
+      .imageMemoryBarrierCount = static_cast<u32>(images.size()),
+      .pImageMemoryBarriers = images.data(),
+    });
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+struct QueueFamilies {
+  static constexpr f32 GRAPHICS_PRIORITY = 1.0f;
+  static constexpr f32 COMPUTE_PRIORITY = 0.75f;
+  static constexpr f32 TRANSFER_PRIORITY = 0.5f;
+
+  u32 graphics{0};
+
+  // compute capable family without graphics, for async compute
+  Option<u32> compute{};
+
+  // transfer only family, usually backed by a DMA engine
+  Option<u32> transfer{};
+
+  [[nodiscard]] static auto find(const vk::raii::PhysicalDevice& device)
+    -> Option<QueueFamilies>;
+
+  [[nodiscard]] auto compute_or_graphics() const -> u32 {
+    return compute.is_some() ? compute.get_unchecked() : graphics;
+  }
+
+  [[nodiscard]] auto transfer_or_graphics() const -> u32 {
+    return transfer.is_some() ? transfer.get_unchecked() : graphics;
+  }
+
+  // one create info per distinct family, priorities must outlive the result
+  [[nodiscard]] auto queue_create_infos() const
+    -> Vec<vk::DeviceQueueCreateInfo>;
+};
+
+// Queue family ownership transfers of exclusive resources. The release half
+// is recorded on a queue of src_family, the acquire half on one of
+// dst_family, and the submissions must be ordered with a semaphore.
+namespace queue_ownership {
+  [[nodiscard]] auto release(
+    vk::Buffer buffer,
+    u32 src_family,
+    u32 dst_family,
+    vk::PipelineStageFlags2 src_stage,
+    vk::AccessFlags2 src_access
+  ) -> vk::BufferMemoryBarrier2;
+
+  [[nodiscard]] auto acquire(
+    vk::Buffer buffer,
+    u32 src_family,
+    u32 dst_family,
+    vk::PipelineStageFlags2 dst_stage,
+    vk::AccessFlags2 dst_access
+  ) -> vk::BufferMemoryBarrier2;
+
+  [[nodiscard]] auto release(
+    vk::Image image,
+    vk::ImageSubresourceRange range,
+    vk::ImageLayout old_layout,
+    vk::ImageLayout new_layout,
+    u32 src_family,
+    u32 dst_family,
+    vk::PipelineStageFlags2 src_stage,
+    vk::AccessFlags2 src_access
+  ) -> vk::ImageMemoryBarrier2;
+
+  [[nodiscard]] auto acquire(
+    vk::Image image,
+    vk::ImageSubresourceRange range,
+    vk::ImageLayout old_layout,
+    vk::ImageLayout new_layout,
+    u32 src_family,
+    u32 dst_family,
+    vk::PipelineStageFlags2 dst_stage,
+    vk::AccessFlags2 dst_access
+  ) -> vk::ImageMemoryBarrier2;
+
+  auto record(
+    const vk::raii::CommandBuffer& cmd,
+    Span<const vk::BufferMemoryBarrier2> buffers,
+    Span<const vk::ImageMemoryBarrier2> images = {}
+  ) -> void;
+}
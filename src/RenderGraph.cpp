@@ -0,0 +1,613 @@
+#include "RenderGraph.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+
+namespace {
+  constexpr vk::AccessFlags2 WRITE_ACCESS{
+    vk::AccessFlagBits2::eShaderWrite
+    | vk::AccessFlagBits2::eShaderStorageWrite
+    | vk::AccessFlagBits2::eColorAttachmentWrite
+    | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+    | vk::AccessFlagBits2::eTransferWrite
+    | vk::AccessFlagBits2::eHostWrite
+    | vk::AccessFlagBits2::eMemoryWrite
+  };
+
+  [[nodiscard]] auto overlaps(
+    const u32 first_a,
+    const u32 last_a,
+    const u32 first_b,
+    const u32 last_b
+  ) -> bool {
+    return first_a <= last_b and first_b <= last_a;
+  }
+}
+
+RenderGraph::~RenderGraph() { clear(); }
+
+auto RenderGraph::init(
+  const vk::raii::Device& device,
+  GpuAllocator& allocator,
+  const u32 frames_in_flight
+) -> void {
+  this->device = &device;
+  this->allocator = &allocator;
+  frames.resize(frames_in_flight);
+}
+
+auto RenderGraph::clear() -> void {
+  for (Transients& transients: frames) {
+    free_transients(transients);
+  }
+
+  frames.clear();
+  resources.clear();
+  states.clear();
+  passes.clear();
+  final_barriers.clear();
+  device = nullptr;
+  allocator = nullptr;
+}
+
+auto RenderGraph::begin(const u32 frame_index) -> void {
+  this->frame_index = frame_index;
+  resources.clear();
+  states.clear();
+  passes.clear();
+  final_barriers.clear();
+  stats = {};
+}
+
+auto RenderGraph::import_image(
+  const StringView name,
+  const vk::Image image,
+  const vk::ImageView view,
+  const Access& initial,
+  const vk::ImageLayout final_layout,
+  const vk::ImageAspectFlags aspect
+) -> ResourceId {
+  resources.push_back({
+    .name = name,
+    .kind = Kind::eImage,
+    .imported = true,
+    .image = image,
+    .view = view,
+    .aspect = aspect,
+    .final_layout = final_layout,
+  });
+
+  State state{.layout = initial.layout};
+
+  if (is_write(initial.access)) {
+    state.write_stages = initial.stages;
+    state.write_access = initial.access;
+  } else {
+    state.read_stages = initial.stages;
+    state.read_access = initial.access;
+  }
+
+  states.push_back(state);
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+auto RenderGraph::import_buffer(
+  const StringView name,
+  const vk::Buffer buffer,
+  const Access& initial
+) -> ResourceId {
+  resources.push_back({
+    .name = name,
+    .kind = Kind::eBuffer,
+    .imported = true,
+    .buffer = buffer,
+  });
+
+  State state{};
+
+  if (is_write(initial.access)) {
+    state.write_stages = initial.stages;
+    state.write_access = initial.access;
+  } else {
+    state.read_stages = initial.stages;
+    state.read_access = initial.access;
+  }
+
+  states.push_back(state);
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+auto RenderGraph::create_image(const StringView name, const ImageDesc& desc)
+  -> ResourceId {
+  resources.push_back({
+    .name = name,
+    .kind = Kind::eImage,
+    .imported = false,
+    .aspect = desc.aspect,
+    .desc = desc,
+  });
+
+  // whatever the memory held before is discarded
+  states.push_back({});
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+auto RenderGraph::add_pass(
+  const StringView name,
+  Vec<Use> uses,
+  Execute execute,
+  const bool side_effects
+) -> void {
+  Pass pass{
+    .name = name,
+    .execute = std::move(execute),
+    .side_effects = side_effects,
+  };
+
+  // a resource used several ways by one pass gets one barrier covering all
+  // of them, in the one layout they share
+  for (const Use& use: uses) {
+    auto found = ranges::find(pass.uses, use.resource, &Use::resource);
+
+    if (found == pass.uses.end()) {
+      pass.uses.push_back(use);
+      continue;
+    }
+
+    if (found->access.layout != use.access.layout) {
+      throw std::runtime_error{fmt::format(
+        "Render graph pass '{}' uses '{}' in two layouts",
+        name,
+        resources.at(use.resource).name
+      )};
+    }
+
+    found->access.stages |= use.access.stages;
+    found->access.access |= use.access.access;
+  }
+
+  passes.push_back(std::move(pass));
+}
+
+auto RenderGraph::compile() -> void {
+  cull();
+  place_transients();
+  build_barriers();
+
+  stats.passes = static_cast<u32>(passes.size());
+
+  for (const Pass& pass: passes) {
+    stats.culled_passes += pass.culled ? 1 : 0;
+    stats.image_barriers += static_cast<u32>(pass.image_barriers.size());
+    stats.buffer_barriers += static_cast<u32>(pass.buffer_barriers.size());
+  }
+
+  stats.image_barriers += static_cast<u32>(final_barriers.size());
+}
+
+auto RenderGraph::execute(const vk::raii::CommandBuffer& cmd) -> void {
+  for (const Pass& pass: passes) {
+    if (pass.culled) {
+      continue;
+    }
+
+    if (not pass.image_barriers.empty() or not pass.buffer_barriers.empty()) {
+      cmd.pipelineBarrier2({
+        .bufferMemoryBarrierCount =
+          static_cast<u32>(pass.buffer_barriers.size()),
+        .pBufferMemoryBarriers = pass.buffer_barriers.data(),
+        .imageMemoryBarrierCount = static_cast<u32>(pass.image_barriers.size()),
+        .pImageMemoryBarriers = pass.image_barriers.data(),
+      });
+    }
+
+    pass.execute(cmd);
+  }
+
+  if (not final_barriers.empty()) {
+    cmd.pipelineBarrier2({
+      .imageMemoryBarrierCount = static_cast<u32>(final_barriers.size()),
+      .pImageMemoryBarriers = final_barriers.data(),
+    });
+  }
+}
+
+auto RenderGraph::get_image(const ResourceId resource) const -> vk::Image {
+  const Resource& found{resources.at(resource)};
+
+  if (found.imported) {
+    return found.image;
+  }
+
+  return *frames.at(frame_index).images.at(found.physical).image;
+}
+
+auto RenderGraph::get_image_view(const ResourceId resource) const
+  -> vk::ImageView {
+  const Resource& found{resources.at(resource)};
+
+  if (found.imported) {
+    return found.view;
+  }
+
+  return *frames.at(frame_index).images.at(found.physical).view;
+}
+
+auto RenderGraph::get_buffer(const ResourceId resource) const -> vk::Buffer {
+  return resources.at(resource).buffer;
+}
+
+auto RenderGraph::cull() -> void {
+  // imported resources outlive the frame, so whatever writes them counts
+  Vec<bool> needed(resources.size(), false);
+
+  for (usize i = 0; i < resources.size(); i++) {
+    needed.at(i) = resources.at(i).imported;
+  }
+
+  for (Pass& pass: passes | std::views::reverse) {
+    pass.culled = not pass.side_effects
+              and ranges::none_of(pass.uses, [&](const Use& use) {
+                    return is_write(use.access.access)
+                       and needed.at(use.resource);
+                  });
+
+    if (pass.culled) {
+      continue;
+    }
+
+    // a write may only be partial, so earlier writers are kept as well
+    for (const Use& use: pass.uses) {
+      needed.at(use.resource) = true;
+    }
+  }
+
+  for (u32 i = 0; i < passes.size(); i++) {
+    if (passes.at(i).culled) {
+      continue;
+    }
+
+    for (const Use& use: passes.at(i).uses) {
+      Resource& resource{resources.at(use.resource)};
+      resource.first_pass = std::min(resource.first_pass, i);
+      resource.last_pass = resource.last_pass == NONE
+                           ? i
+                           : std::max(resource.last_pass, i);
+    }
+  }
+}
+
+auto RenderGraph::place_transients() -> void {
+  Vec<Lifetime> lifetimes{};
+  Vec<ResourceId> transients{};
+
+  for (u32 i = 0; i < resources.size(); i++) {
+    const Resource& resource{resources.at(i)};
+
+    if (resource.imported or resource.first_pass == NONE) {
+      continue;
+    }
+
+    lifetimes.push_back({
+      .desc = resource.desc,
+      .first_pass = resource.first_pass,
+      .last_pass = resource.last_pass,
+    });
+    transients.push_back(i);
+  }
+
+  Transients& slot{frames.at(frame_index)};
+
+  // the same frame shape as last time this slot was used, which is nearly
+  // always, keeps its images
+  if (slot.lifetimes != lifetimes) {
+    free_transients(slot);
+    build_transients(slot, std::move(lifetimes));
+  }
+
+  for (u32 i = 0; i < transients.size(); i++) {
+    resources.at(transients.at(i)).physical = i;
+  }
+
+  for (const MemoryBlock& block: slot.blocks) {
+    stats.transient_bytes += block.requirements.size;
+  }
+
+  for (const PhysicalImage& image: slot.images) {
+    stats.unaliased_bytes += image.size;
+  }
+}
+
+auto RenderGraph::build_transients(
+  Transients& transients,
+  Vec<Lifetime> lifetimes
+) -> void {
+  transients.lifetimes = std::move(lifetimes);
+
+  Vec<vk::MemoryRequirements> requirements{};
+
+  for (const Lifetime& lifetime: transients.lifetimes) {
+    const ImageDesc& desc{lifetime.desc};
+
+    vk::raii::Image image{
+      *device,
+      vk::ImageCreateInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = desc.format,
+        .extent = {desc.extent.width, desc.extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = desc.usage,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined,
+      },
+    };
+
+    requirements.push_back(image.getMemoryRequirements());
+    transients.images.push_back({
+      .desc = desc,
+      .size = requirements.back().size,
+      .block = NONE,
+      .image = std::move(image),
+    });
+  }
+
+  // largest first, each into the first block it is compatible with and
+  // whose occupants are all dead before it starts or born after it ends
+  Vec<u32> order(transients.images.size());
+  std::iota(order.begin(), order.end(), 0u);
+  ranges::stable_sort(order, [&](const u32 a, const u32 b) {
+    return requirements.at(a).size > requirements.at(b).size;
+  });
+
+  for (const u32 i: order) {
+    const Lifetime& lifetime{transients.lifetimes.at(i)};
+    const vk::MemoryRequirements& required{requirements.at(i)};
+
+    for (u32 block = 0; block < transients.blocks.size(); block++) {
+      const vk::MemoryRequirements& shared{
+        transients.blocks.at(block).requirements
+      };
+
+      if ((shared.memoryTypeBits & required.memoryTypeBits) == 0) {
+        continue;
+      }
+
+      const bool is_free = ranges::none_of(order, [&](const u32 other) {
+        const Lifetime& placed{transients.lifetimes.at(other)};
+        return transients.images.at(other).block == block
+           and overlaps(
+                 placed.first_pass,
+                 placed.last_pass,
+                 lifetime.first_pass,
+                 lifetime.last_pass
+               );
+      });
+
+      if (not is_free) {
+        continue;
+      }
+
+      transients.images.at(i).block = block;
+      break;
+    }
+
+    if (transients.images.at(i).block == NONE) {
+      transients.images.at(i).block =
+        static_cast<u32>(transients.blocks.size());
+      transients.blocks.push_back({.requirements = required});
+      continue;
+    }
+
+    vk::MemoryRequirements& shared{
+      transients.blocks.at(transients.images.at(i).block).requirements
+    };
+    shared.size = std::max(shared.size, required.size);
+    shared.alignment = std::max(shared.alignment, required.alignment);
+    shared.memoryTypeBits &= required.memoryTypeBits;
+  }
+
+  for (MemoryBlock& block: transients.blocks) {
+    block.allocation = allocator->allocate(
+      block.requirements,
+      vk::MemoryPropertyFlagBits::eDeviceLocal,
+      ResourceKind::eImage
+    );
+  }
+
+  for (PhysicalImage& physical: transients.images) {
+    const GpuAllocation& allocation{
+      transients.blocks.at(physical.block).allocation
+    };
+    physical.image.bindMemory(allocation.memory, allocation.offset);
+
+    physical.view = vk::raii::ImageView{
+      *device,
+      vk::ImageViewCreateInfo{
+        .image = *physical.image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = physical.desc.format,
+        .subresourceRange = {
+          .aspectMask = physical.desc.aspect,
+          .levelCount = 1,
+          .layerCount = 1,
+        },
+      },
+    };
+  }
+
+  spdlog::info(
+    "Render graph slot {}: {} transient image(s) in {} memory block(s)",
+    frame_index,
+    transients.images.size(),
+    transients.blocks.size()
+  );
+}
+
+auto RenderGraph::free_transients(Transients& transients) -> void {
+  // images go before the memory they are bound to
+  transients.images.clear();
+
+  for (const MemoryBlock& block: transients.blocks) {
+    allocator->free(block.allocation);
+  }
+
+  transients.blocks.clear();
+  transients.lifetimes.clear();
+}
+
+auto RenderGraph::build_barriers() -> void {
+  for (u32 i = 0; i < passes.size(); i++) {
+    Pass& pass{passes.at(i)};
+
+    if (pass.culled) {
+      continue;
+    }
+
+    for (const Use& use: pass.uses) {
+      const Resource& resource{resources.at(use.resource)};
+      State& state{states.at(use.resource)};
+
+      // memory shared with an image that died earlier this frame, whatever
+      // touched it last has to be done before this one starts using it
+      if (not resource.imported and resource.first_pass == i) {
+        for (ResourceId other = 0; other < resources.size(); other++) {
+          const Resource& previous{resources.at(other)};
+
+          if (previous.imported or previous.physical == NONE
+              or previous.last_pass >= i
+              or frames.at(frame_index).images.at(previous.physical).block
+                   != frames.at(frame_index)
+                        .images.at(resource.physical)
+                        .block) {
+            continue;
+          }
+
+          state.write_stages |= states.at(other).write_stages;
+          state.write_access |= states.at(other).write_access;
+          state.read_stages |= states.at(other).read_stages;
+        }
+      }
+
+      transition(use.resource, state, use.access, pass);
+    }
+  }
+
+  for (ResourceId i = 0; i < resources.size(); i++) {
+    const Resource& resource{resources.at(i)};
+    const State& state{states.at(i)};
+
+    if (resource.kind != Kind::eImage or not resource.imported
+        or resource.final_layout == vk::ImageLayout::eUndefined
+        or resource.final_layout == state.layout) {
+      continue;
+    }
+
+    // whoever takes the image over waits on a semaphore the submit signals
+    // at eAllCommands, the transition only happens before that signal if it
+    // is ordered before the same stages. Bottom of pipe would be none under
+    // sync2 and leave it out
+    final_barriers.push_back({
+      .srcStageMask = state.write_stages | state.read_stages,
+      .srcAccessMask = state.write_access,
+      .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+      .dstAccessMask = {},
+      .oldLayout = state.layout,
+      .newLayout = resource.final_layout,
+      .image = resource.image,
+      .subresourceRange = {
+        .aspectMask = resource.aspect,
+        .levelCount = vk::RemainingMipLevels,
+        .layerCount = vk::RemainingArrayLayers,
+      },
+    });
+  }
+}
+
+auto RenderGraph::transition(
+  const ResourceId resource,
+  State& state,
+  const Access& access,
+  Pass& pass
+) -> void {
+  const Resource& found{resources.at(resource)};
+  const bool is_image{found.kind == Kind::eImage};
+  const bool writes{is_write(access.access)};
+  const vk::ImageLayout old_layout{state.layout};
+  const bool changes_layout{is_image and old_layout != access.layout};
+
+  vk::PipelineStageFlags2 src_stages{};
+  vk::AccessFlags2 src_access{};
+
+  if (writes or changes_layout) {
+    // has to wait on the last write and on every read since, but only the
+    // write has anything to make available
+    src_stages = state.write_stages | state.read_stages;
+    src_access = state.write_access;
+
+    // a layout transition is a write of its own, done by the time the
+    // barrier's destination stages start
+    state = {
+      .layout = is_image ? access.layout : vk::ImageLayout::eUndefined,
+      .write_stages = access.stages,
+      .write_access = writes ? access.access : vk::AccessFlags2{},
+      .read_stages = writes ? vk::PipelineStageFlags2{} : access.stages,
+      .read_access = writes ? vk::AccessFlags2{} : access.access,
+    };
+  } else {
+    // a read that an earlier barrier already made the last write visible to
+    // needs nothing more
+    const bool is_visible{
+      (access.stages & ~state.read_stages) == vk::PipelineStageFlags2{}
+      and (access.access & ~state.read_access) == vk::AccessFlags2{}
+    };
+
+    if (not is_visible) {
+      src_stages = state.write_stages;
+      src_access = state.write_access;
+    }
+
+    state.read_stages |= access.stages;
+    state.read_access |= access.access;
+  }
+
+  if (src_stages == vk::PipelineStageFlags2{} and not changes_layout) {
+    return;
+  }
+
+  if (is_image) {
+    pass.image_barriers.push_back({
+      .srcStageMask = src_stages,
+      .srcAccessMask = src_access,
+      .dstStageMask = access.stages,
+      .dstAccessMask = access.access,
+      .oldLayout = old_layout,
+      .newLayout = access.layout,
+      .image = get_image(resource),
+      .subresourceRange = {
+        .aspectMask = found.aspect,
+        .levelCount = vk::RemainingMipLevels,
+        .layerCount = vk::RemainingArrayLayers,
+      },
+    });
+    return;
+  }
+
+  pass.buffer_barriers.push_back({
+    .srcStageMask = src_stages,
+    .srcAccessMask = src_access,
+    .dstStageMask = access.stages,
+    .dstAccessMask = access.access,
+    .buffer = found.buffer,
+    .offset = 0,
+    .size = vk::WholeSize,
+  });
+}
+
+auto RenderGraph::is_write(const vk::AccessFlags2 access) -> bool {
+  return (access & WRITE_ACCESS) != vk::AccessFlags2{};
+}
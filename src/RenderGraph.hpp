@@ -0,0 +1,299 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <functional>
+#include <limits>
+#include "GpuAllocator.hpp"
+
+// Rebuilt every frame: passes declare which images and buffers they read and
+// write, and the graph works out everything in between.
+//
+// * passes whose results nothing reads are culled
+// * each pass is preceded by one vkCmdPipelineBarrier2 holding exactly the
+//   barriers its uses need, reads of the same layout are never serialised
+//   against each other
+// * transient images only live for the frame, ones whose lifetimes do not
+//   overlap share the same memory
+//
+// Passes run in the order they were added, which has to be a valid order.
+class RenderGraph {
+public:
+
+  using ResourceId = u32;
+  using Execute = std::function<void(const vk::raii::CommandBuffer&)>;
+
+  // how a pass touches a resource, layout only matters for images
+  struct Access {
+    vk::PipelineStageFlags2 stages{};
+    vk::AccessFlags2 access{};
+    vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+  };
+
+  static constexpr Access COLOR_ATTACHMENT_WRITE{
+    .stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+    .access = vk::AccessFlagBits2::eColorAttachmentWrite,
+    .layout = vk::ImageLayout::eColorAttachmentOptimal,
+  };
+
+  static constexpr Access FRAGMENT_SAMPLED_READ{
+    .stages = vk::PipelineStageFlagBits2::eFragmentShader,
+    .access = vk::AccessFlagBits2::eShaderSampledRead,
+    .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+  };
+
+  static constexpr Access COMPUTE_STORAGE_READ{
+    .stages = vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eShaderStorageRead,
+    .layout = vk::ImageLayout::eGeneral,
+  };
+
+  static constexpr Access COMPUTE_STORAGE_WRITE{
+    .stages = vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eShaderStorageWrite,
+    .layout = vk::ImageLayout::eGeneral,
+  };
+
+  static constexpr Access INDIRECT_READ{
+    .stages = vk::PipelineStageFlagBits2::eDrawIndirect,
+    .access = vk::AccessFlagBits2::eIndirectCommandRead,
+  };
+
+  static constexpr Access TRANSFER_READ{
+    .stages = vk::PipelineStageFlagBits2::eCopy,
+    .access = vk::AccessFlagBits2::eTransferRead,
+    .layout = vk::ImageLayout::eTransferSrcOptimal,
+  };
+
+  static constexpr Access TRANSFER_WRITE{
+    .stages = vk::PipelineStageFlagBits2::eCopy
+            | vk::PipelineStageFlagBits2::eClear,
+    .access = vk::AccessFlagBits2::eTransferWrite,
+    .layout = vk::ImageLayout::eTransferDstOptimal,
+  };
+
+  static constexpr Access BLIT_READ{
+    .stages = vk::PipelineStageFlagBits2::eBlit,
+    .access = vk::AccessFlagBits2::eTransferRead,
+    .layout = vk::ImageLayout::eTransferSrcOptimal,
+  };
+
+  static constexpr Access BLIT_WRITE{
+    .stages = vk::PipelineStageFlagBits2::eBlit,
+    .access = vk::AccessFlagBits2::eTransferWrite,
+    .layout = vk::ImageLayout::eTransferDstOptimal,
+  };
+
+  struct Use {
+    ResourceId resource;
+    Access access;
+  };
+
+  // a transient image, the graph owns its memory
+  struct ImageDesc {
+    vk::Format format{vk::Format::eUndefined};
+    vk::Extent2D extent{};
+    vk::ImageUsageFlags usage{};
+    vk::ImageAspectFlags aspect{vk::ImageAspectFlagBits::eColor};
+
+    auto operator==(const ImageDesc&) const -> bool = default;
+  };
+
+  struct Stats {
+    u32 passes{0};
+    u32 culled_passes{0};
+    u32 image_barriers{0};
+    u32 buffer_barriers{0};
+
+    // memory behind this frame's transient images, and what it would have
+    // been without aliasing
+    vk::DeviceSize transient_bytes{0};
+    vk::DeviceSize unaliased_bytes{0};
+  };
+
+  RenderGraph() = default;
+
+  RenderGraph(const RenderGraph&) = delete;
+  RenderGraph(RenderGraph&&) = delete;
+  auto operator=(const RenderGraph&) -> RenderGraph& = delete;
+  auto operator=(RenderGraph&&) -> RenderGraph& = delete;
+  ~RenderGraph();
+
+  // transient memory is kept per frame slot, the slot wait covers its reuse
+  auto init(
+    const vk::raii::Device& device,
+    GpuAllocator& allocator,
+    u32 frames_in_flight
+  ) -> void;
+
+  // frees every transient image, the device must be idle
+  auto clear() -> void;
+
+  // drops the passes and resources of the previous frame
+  auto begin(u32 frame_index) -> void;
+
+  // an image owned by someone else, in layout / last touched by access when
+  // the frame starts, and left in final_layout when it ends
+  auto import_image(
+    StringView name,
+    vk::Image image,
+    vk::ImageView view,
+    const Access& initial,
+    vk::ImageLayout final_layout,
+    vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor
+  ) -> ResourceId;
+
+  // a buffer owned by someone else, last touched by initial
+  auto import_buffer(StringView name, vk::Buffer buffer, const Access& initial)
+    -> ResourceId;
+
+  [[nodiscard]] auto create_image(StringView name, const ImageDesc& desc)
+    -> ResourceId;
+
+  // side_effects keeps the pass even if nothing reads what it writes, for
+  // passes that synchronise themselves (eg. uploads)
+  auto add_pass(
+    StringView name,
+    Vec<Use> uses,
+    Execute execute,
+    bool side_effects = false
+  ) -> void;
+
+  // culls, places transient images and works out the barriers, records
+  // nothing
+  auto compile() -> void;
+
+  auto execute(const vk::raii::CommandBuffer& cmd) -> void;
+
+  // only valid from compile() until the next begin()
+
+  [[nodiscard]] auto get_image(ResourceId resource) const -> vk::Image;
+
+  [[nodiscard]] auto get_image_view(ResourceId resource) const
+    -> vk::ImageView;
+
+  [[nodiscard]] auto get_buffer(ResourceId resource) const -> vk::Buffer;
+
+  [[nodiscard]] auto get_stats() const -> const Stats& { return stats; }
+
+private:
+
+  static constexpr u32 NONE = std::numeric_limits<u32>::max();
+
+  enum class Kind {
+    eImage,
+    eBuffer,
+  };
+
+  struct Resource {
+    StringView name;
+    Kind kind;
+    bool imported;
+
+    vk::Image image{};
+    vk::ImageView view{};
+    vk::Buffer buffer{};
+    vk::ImageAspectFlags aspect{};
+
+    // imported images only
+    vk::ImageLayout final_layout{vk::ImageLayout::eUndefined};
+
+    // transient images only
+    ImageDesc desc{};
+    u32 first_pass{NONE};
+    u32 last_pass{NONE};
+    u32 physical{NONE};
+  };
+
+  // what the barriers still have to cover
+  struct State {
+    vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+
+    // the last write, every later access has to wait on it
+    vk::PipelineStageFlags2 write_stages{};
+    vk::AccessFlags2 write_access{};
+
+    // reads since the last write, which the next write has to wait on
+    vk::PipelineStageFlags2 read_stages{};
+    vk::AccessFlags2 read_access{};
+  };
+
+  struct Pass {
+    StringView name;
+    Vec<Use> uses;
+    Execute execute;
+    bool side_effects;
+    bool culled{false};
+    Vec<vk::ImageMemoryBarrier2> image_barriers{};
+    Vec<vk::BufferMemoryBarrier2> buffer_barriers{};
+  };
+
+  // one transient image and its view, bound at offset 0 of a memory block
+  struct PhysicalImage {
+    ImageDesc desc;
+    vk::DeviceSize size;
+    u32 block;
+    vk::raii::Image image{nullptr};
+    vk::raii::ImageView view{nullptr};
+  };
+
+  // memory shared by transient images that are never alive at once
+  struct MemoryBlock {
+    vk::MemoryRequirements requirements{};
+    GpuAllocation allocation{};
+  };
+
+  // what a slot's transient images were built for
+  struct Lifetime {
+    ImageDesc desc;
+    u32 first_pass;
+    u32 last_pass;
+
+    auto operator==(const Lifetime&) const -> bool = default;
+  };
+
+  // per frame slot, rebuilt whenever the transient images change
+  struct Transients {
+    Vec<Lifetime> lifetimes{};
+    Vec<PhysicalImage> images{};
+    Vec<MemoryBlock> blocks{};
+  };
+
+  auto cull() -> void;
+
+  auto place_transients() -> void;
+
+  auto build_transients(Transients& transients, Vec<Lifetime> lifetimes)
+    -> void;
+
+  auto free_transients(Transients& transients) -> void;
+
+  auto build_barriers() -> void;
+
+  // adds the barrier access needs after state to pass, if any, and moves
+  // state on to access
+  auto transition(
+    ResourceId resource,
+    State& state,
+    const Access& access,
+    Pass& pass
+  ) -> void;
+
+  [[nodiscard]] static auto is_write(vk::AccessFlags2 access) -> bool;
+
+  const vk::raii::Device* device{nullptr};
+  GpuAllocator* allocator{nullptr};
+
+  Vec<Resource> resources{};
+  Vec<State> states{};
+  Vec<Pass> passes{};
+
+  // imported images that have to end up in their final layout
+  Vec<vk::ImageMemoryBarrier2> final_barriers{};
+
+  Vec<Transients> frames{};
+  u32 frame_index{0};
+
+  Stats stats{};
+};
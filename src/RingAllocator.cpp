@@ -0,0 +1,68 @@
+#include "RingAllocator.hpp"
+
+RingAllocator::RingAllocator(const u64 size, const u64 alignment):
+    size{size}, alignment{alignment} {}
+
+auto RingAllocator::allocate(u64 size) -> Option<u64> {
+  size = (size + alignment - 1) / alignment * alignment;
+
+  if (size == 0 or size > this->size - used) {
+    return crab::none;
+  }
+
+  if (used == 0) {
+    head = 0;
+    tail = 0;
+  }
+
+  // free space is [head, end) + [0, tail)
+  if (head >= tail) {
+    if (this->size - head >= size) {
+      const u64 offset{head};
+      head += size;
+      consume(size);
+      return offset;
+    }
+
+    if (tail >= size) {
+      // the tail end of the ring is too small, skip it and wrap around
+      consume(this->size - head + size);
+      head = size;
+      return 0;
+    }
+
+    return crab::none;
+  }
+
+  // free space is [head, tail)
+  if (tail - head >= size) {
+    const u64 offset{head};
+    head += size;
+    consume(size);
+    return offset;
+  }
+
+  return crab::none;
+}
+
+auto RingAllocator::submit(const u64 value) -> void {
+  if (pending_bytes == 0) {
+    return;
+  }
+
+  in_flight.push_back({.end = head, .bytes = pending_bytes, .value = value});
+  pending_bytes = 0;
+}
+
+auto RingAllocator::retire(const u64 completed_value) -> void {
+  while (not in_flight.empty() and in_flight.front().value <= completed_value) {
+    used -= in_flight.front().bytes;
+    tail = in_flight.front().end;
+    in_flight.pop_front();
+  }
+}
+
+auto RingAllocator::consume(const u64 bytes) -> void {
+  used += bytes;
+  pending_bytes += bytes;
+}
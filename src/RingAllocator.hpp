@@ -0,0 +1,52 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+#include <deque>
+
+// FIFO ring over an abstract range of offsets. Space handed out since the
+// last submit() is tagged with a timeline value and only becomes reusable
+// once retire() is called with a completed value at least that large.
+class RingAllocator {
+public:
+
+  RingAllocator() = default;
+
+  RingAllocator(u64 size, u64 alignment);
+
+  // contiguous range of size bytes, none if the ring is full right now
+  [[nodiscard]] auto allocate(u64 size) -> Option<u64>;
+
+  // tags everything allocated since the previous submit with value
+  auto submit(u64 value) -> void;
+
+  auto retire(u64 completed_value) -> void;
+
+  [[nodiscard]] auto get_size() const -> u64 { return size; }
+
+  [[nodiscard]] auto get_used() const -> u64 { return used; }
+
+  [[nodiscard]] auto get_alignment() const -> u64 { return alignment; }
+
+private:
+
+  struct Segment {
+    u64 end;
+    u64 bytes;
+    u64 value;
+  };
+
+  auto consume(u64 bytes) -> void;
+
+  u64 size{0};
+  u64 alignment{1};
+
+  u64 head{0};
+  u64 tail{0};
+
+  // includes padding skipped when wrapping, so head == tail is unambiguous
+  u64 used{0};
+  u64 pending_bytes{0};
+
+  std::deque<Segment> in_flight{};
+};
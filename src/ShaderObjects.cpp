@@ -0,0 +1,141 @@
+#include "ShaderObjects.hpp"
+#include <spdlog/spdlog.h>
+#include "Mesh.hpp"
+
+namespace {
+  constexpr std::array VERTEX_BINDINGS{
+    vk::VertexInputBindingDescription2EXT{
+      .binding = Vertex::BINDING.binding,
+      .stride = Vertex::BINDING.stride,
+      .inputRate = Vertex::BINDING.inputRate,
+      .divisor = 1,
+    },
+    vk::VertexInputBindingDescription2EXT{
+      .binding = InstanceData::BINDING.binding,
+      .stride = InstanceData::BINDING.stride,
+      .inputRate = InstanceData::BINDING.inputRate,
+      .divisor = 1,
+    },
+  };
+
+  [[nodiscard]] constexpr auto to_attribute(
+    const vk::VertexInputAttributeDescription& attribute
+  ) -> vk::VertexInputAttributeDescription2EXT {
+    return {
+      .location = attribute.location,
+      .binding = attribute.binding,
+      .format = attribute.format,
+      .offset = attribute.offset,
+    };
+  }
+
+  constexpr std::array VERTEX_ATTRIBUTES{
+    to_attribute(Vertex::ATTRIBUTES[0]),
+    to_attribute(Vertex::ATTRIBUTES[1]),
+    to_attribute(InstanceData::ATTRIBUTES[0]),
+    to_attribute(InstanceData::ATTRIBUTES[1]),
+  };
+
+  constexpr std::array STAGES{
+    vk::ShaderStageFlagBits::eVertex,
+    vk::ShaderStageFlagBits::eFragment,
+  };
+}
+
+ShaderObjects::ShaderObjects(
+  const vk::raii::Device& device,
+  const BindlessHeap& heap,
+  const Span<const u32> spirv
+) {
+  const Span<const vk::DescriptorSetLayout> set_layouts{
+    heap.get_set_layouts()
+  };
+
+  const vk::PushConstantRange push_constant_range{
+    .stageFlags = BindlessHeap::STAGES,
+    .offset = 0,
+    .size = BindlessHeap::PUSH_CONSTANT_SIZE,
+  };
+
+  const auto create_info = [&](
+                             const vk::ShaderStageFlagBits stage,
+                             const vk::ShaderStageFlags next_stage,
+                             const char* entry_point
+                           ) -> vk::ShaderCreateInfoEXT {
+    return {
+      .flags = vk::ShaderCreateFlagBitsEXT::eLinkStage,
+      .stage = stage,
+      .nextStage = next_stage,
+      .codeType = vk::ShaderCodeTypeEXT::eSpirv,
+      .codeSize = spirv.size_bytes(),
+      .pCode = spirv.data(),
+      .pName = entry_point,
+      .setLayoutCount = static_cast<u32>(set_layouts.size()),
+      .pSetLayouts = set_layouts.data(),
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &push_constant_range,
+    };
+  };
+
+  const std::array infos{
+    create_info(
+      vk::ShaderStageFlagBits::eVertex,
+      vk::ShaderStageFlagBits::eFragment,
+      "vertMain"
+    ),
+    create_info(vk::ShaderStageFlagBits::eFragment, {}, "fragMain"),
+  };
+
+  spdlog::info("Creating shader objects");
+
+  Vec<vk::raii::ShaderEXT> shaders{device.createShadersEXT(infos)};
+  vertex = std::move(shaders.at(0));
+  fragment = std::move(shaders.at(1));
+}
+
+auto ShaderObjects::bind(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::Extent2D extent
+) const -> void {
+  cmd.bindShadersEXT(STAGES, {*vertex, *fragment});
+
+  cmd.setVertexInputEXT(VERTEX_BINDINGS, VERTEX_ATTRIBUTES);
+  cmd.setPrimitiveTopology(vk::PrimitiveTopology::eTriangleList);
+  cmd.setPrimitiveRestartEnable(vk::False);
+
+  cmd.setViewportWithCount(
+    vk::Viewport{
+      0.0f,
+      0.0f,
+      static_cast<f32>(extent.width),
+      static_cast<f32>(extent.height),
+      0.0f,
+      1.0f
+    }
+  );
+  cmd.setScissorWithCount(vk::Rect2D{.offset = {0, 0}, .extent = extent});
+
+  cmd.setRasterizerDiscardEnable(vk::False);
+  cmd.setPolygonModeEXT(vk::PolygonMode::eFill);
+  cmd.setCullMode(vk::CullModeFlagBits::eBack);
+  cmd.setFrontFace(vk::FrontFace::eClockwise);
+  cmd.setDepthBiasEnable(vk::False);
+
+  cmd.setDepthTestEnable(vk::False);
+  cmd.setDepthWriteEnable(vk::False);
+  cmd.setDepthCompareOp(vk::CompareOp::eAlways);
+  cmd.setDepthBoundsTestEnable(vk::False);
+  cmd.setStencilTestEnable(vk::False);
+
+  constexpr vk::SampleMask SAMPLE_MASK{~0u};
+  cmd.setRasterizationSamplesEXT(vk::SampleCountFlagBits::e1);
+  cmd.setSampleMaskEXT(vk::SampleCountFlagBits::e1, SAMPLE_MASK);
+  cmd.setAlphaToCoverageEnableEXT(vk::False);
+
+  cmd.setColorBlendEnableEXT(0, vk::False);
+  cmd.setColorWriteMaskEXT(
+    0,
+    vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+      | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+  );
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "BindlessHeap.hpp"
+
+// The triangle shaders as VK_EXT_shader_object shaders instead of a
+// pipeline. Every bit of state a pipeline would bake in is set dynamically
+// by bind(), so there is nothing to permute or link: one vertex and one
+// fragment shader cover every variant, which read theirs from the uniform
+// ring like the generic pipeline does.
+class ShaderObjects {
+public:
+
+  ShaderObjects() = default;
+
+  // the shaders are linked, so the driver may still optimise across them
+  ShaderObjects(
+    const vk::raii::Device& device,
+    const BindlessHeap& heap,
+    Span<const u32> spirv
+  );
+
+  // binds both shaders and sets every piece of state they need, call once
+  // per command buffer as secondaries inherit none of it
+  auto bind(const vk::raii::CommandBuffer& cmd, vk::Extent2D extent) const
+    -> void;
+
+private:
+
+  vk::raii::ShaderEXT vertex{nullptr};
+  vk::raii::ShaderEXT fragment{nullptr};
+};
@@ -0,0 +1,144 @@
+#include "ShaderWatcher.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <cstdlib>
+
+ShaderWatcher::ShaderWatcher(Config config, Callback on_compiled):
+    config{std::move(config)}, on_compiled{std::move(on_compiled)} {
+  // seed the timestamps so the shaders built by cmake are not rebuilt
+  [[maybe_unused]] const bool changed = scan();
+
+  worker = std::thread{[this] { run(); }};
+
+  spdlog::info(
+    "Watching '{}' for shader changes",
+    this->config.source_dir.string()
+  );
+}
+
+ShaderWatcher::~ShaderWatcher() {
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+auto ShaderWatcher::run() -> void {
+  while (true) {
+    {
+      std::unique_lock lock{mutex};
+      wake.wait_for(lock, POLL_INTERVAL, [this] { return stopping.load(); });
+
+      if (stopping) {
+        return;
+      }
+    }
+
+    if (not scan()) {
+      continue;
+    }
+
+    spdlog::info("Shader sources changed, recompiling");
+    const Clock::time_point start{Clock::now()};
+
+    if (not compile()) {
+      // keep the old pipeline, the next save will trigger another attempt
+      continue;
+    }
+
+    try {
+      const MappedFile spirv{MappedFile::open(config.output)};
+      on_compiled(spirv);
+    } catch (const std::exception& e) {
+      spdlog::error("Failed to reload shaders: {}", e.what());
+      continue;
+    }
+
+    const std::chrono::duration<f64, std::milli> elapsed{Clock::now() - start};
+    spdlog::info("Shaders reloaded in {:.1f}ms", elapsed.count());
+  }
+}
+
+auto ShaderWatcher::scan() -> bool {
+  std::error_code error{};
+  bool changed{false};
+
+  std::unordered_map<String, std::filesystem::file_time_type> current{};
+
+  for (const auto& entry:
+       std::filesystem::directory_iterator{config.source_dir, error}) {
+    if (entry.path().extension() != ".slang") {
+      continue;
+    }
+
+    const std::filesystem::file_time_type time{entry.last_write_time(error)};
+
+    if (error) {
+      // most likely an editor replacing the file, pick it up next poll
+      continue;
+    }
+
+    const String path{entry.path().string()};
+    const auto previous = timestamps.find(path);
+
+    if (previous == timestamps.end() or previous->second != time) {
+      changed = true;
+    }
+
+    current.emplace(path, time);
+  }
+
+  if (current.size() != timestamps.size()) {
+    changed = true;
+  }
+
+  timestamps = std::move(current);
+  return changed;
+}
+
+auto ShaderWatcher::compile() const -> bool {
+  // the same flags add_slang_shader builds the embedded modules with. Its
+  // optional spirv-opt pass is skipped, that only strips debug info
+  String command{fmt::format("\"{}\"", config.compiler)};
+
+  for (const std::filesystem::path& source: config.sources) {
+    command += fmt::format(" \"{}\"", source.string());
+  }
+
+  command += fmt::format(" {}", config.flags);
+
+  for (const String& entry: config.entry_points) {
+    command += fmt::format(" -entry {}", entry);
+  }
+
+  // compile next to the output and rename over it, so the file is never seen
+  // half written
+  std::filesystem::path temp_output{config.output};
+  temp_output += ".tmp";
+
+  command += fmt::format(" -o \"{}\"", temp_output.string());
+
+  if (std::system(command.c_str()) != 0) { // NOLINT
+    spdlog::error("slangc failed: {}", command);
+    return false;
+  }
+
+  std::error_code error{};
+  std::filesystem::rename(temp_output, config.output, error);
+
+  if (error) {
+    spdlog::error(
+      "Failed to replace '{}': {}",
+      config.output.string(),
+      error.message()
+    );
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "MappedFile.hpp"
+
+// Dev-mode watcher that polls a directory of Slang sources on a worker
+// thread, recompiles them with slangc when any of them change and hands the
+// new SPIR-V to on_compiled, still on the worker thread.
+class ShaderWatcher {
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr Clock::duration POLL_INTERVAL =
+    std::chrono::milliseconds{250};
+
+  struct Config {
+    String compiler{};
+
+    // everything but the sources, entry points and output, as one string
+    String flags{};
+
+    std::filesystem::path source_dir{};
+
+    // compiled into output, any .slang in source_dir triggers a rebuild
+    Vec<std::filesystem::path> sources{};
+    std::filesystem::path output{};
+    Vec<String> entry_points{};
+  };
+
+  using Callback = std::function<void(const MappedFile& spirv)>;
+
+  ShaderWatcher(Config config, Callback on_compiled);
+
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ShaderWatcher(ShaderWatcher&&) = delete;
+  auto operator=(const ShaderWatcher&) -> ShaderWatcher& = delete;
+  auto operator=(ShaderWatcher&&) -> ShaderWatcher& = delete;
+  ~ShaderWatcher();
+
+private:
+
+  auto run() -> void;
+
+  // returns true if any source was added, removed or modified since last scan
+  [[nodiscard]] auto scan() -> bool;
+
+  [[nodiscard]] auto compile() const -> bool;
+
+  Config config;
+  Callback on_compiled;
+
+  std::unordered_map<String, std::filesystem::file_time_type> timestamps{};
+
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  std::atomic<bool> stopping{false};
+  std::thread worker{};
+};
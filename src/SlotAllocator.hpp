@@ -0,0 +1,63 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <option.hpp>
+
+// Hands out indices in [0, capacity). Released indices may still be
+// referenced by in-flight GPU work, so like DeletionQueue they only become
+// free again once the frame timeline passes the value they were released at.
+class SlotAllocator {
+public:
+
+  SlotAllocator() = default;
+
+  explicit SlotAllocator(const u32 capacity): capacity{capacity} {}
+
+  // none once every slot is in use or waiting to be collected
+  [[nodiscard]] auto allocate() -> Option<u32> {
+    if (not free_slots.empty()) {
+      const u32 slot{free_slots.back()};
+      free_slots.pop_back();
+      return slot;
+    }
+
+    if (next_unused == capacity) {
+      return crab::none;
+    }
+
+    return next_unused++;
+  }
+
+  auto release(const u32 slot, const u64 value) -> void {
+    retired.push_back({.value = value, .slot = slot});
+  }
+
+  auto collect(const u64 completed_value) -> void {
+    std::erase_if(retired, [&](const Retired& entry) {
+      if (entry.value > completed_value) {
+        return false;
+      }
+
+      free_slots.push_back(entry.slot);
+      return true;
+    });
+  }
+
+  [[nodiscard]] auto get_capacity() const -> u32 { return capacity; }
+
+  [[nodiscard]] auto in_use() const -> u32 {
+    return next_unused - static_cast<u32>(free_slots.size());
+  }
+
+private:
+
+  struct Retired {
+    u64 value;
+    u32 slot;
+  };
+
+  u32 capacity{0};
+  u32 next_unused{0};
+  Vec<u32> free_slots{};
+  Vec<Retired> retired{};
+};
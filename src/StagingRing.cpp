@@ -0,0 +1,175 @@
+#include "StagingRing.hpp"
+#include "Queues.hpp"
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+auto StagingRing::init(
+  GpuAllocator& allocator,
+  const vk::DeviceSize size,
+  const vk::DeviceSize alignment
+) -> void {
+  buffer = allocator.create_buffer(
+    {
+      .size = size,
+      .usage = vk::BufferUsageFlagBits::eTransferSrc,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eHostVisible
+  );
+
+  ring = RingAllocator{size, alignment};
+  pending.clear();
+
+  spdlog::info("Staging ring: {} KiB", size >> 10);
+}
+
+auto StagingRing::clear() -> void {
+  pending.clear();
+  uploaded.clear();
+  buffer.reset();
+}
+
+auto StagingRing::upload(
+  const Span<const u8> data,
+  const vk::Buffer dst,
+  const vk::DeviceSize dst_offset
+) -> bool {
+  const Option<u64> offset{ring.allocate(data.size())};
+
+  if (offset.is_none()) {
+    return false;
+  }
+
+  const u64 src_offset{offset.get_unchecked()};
+  std::memcpy(buffer.mapped() + src_offset, data.data(), data.size());
+
+  pending.push_back({
+    .dst = dst,
+    .region = {
+      .srcOffset = src_offset,
+      .dstOffset = dst_offset,
+      .size = data.size(),
+    },
+  });
+
+  return true;
+}
+
+auto StagingRing::has_pending_first_uploads() const -> bool {
+  return ranges::any_of(pending, [this](const PendingCopy& copy) {
+    return not uploaded.contains(copy.dst);
+  });
+}
+
+auto StagingRing::flush(
+  const vk::raii::CommandBuffer& cmd,
+  const u64 timeline_value,
+  const Option<QueueTransfer> transfer
+) -> Vec<vk::BufferMemoryBarrier2> {
+  // a destination that was uploaded to before may be in use by frames still
+  // in flight, and belongs to the queue that reads it, so it is left for a
+  // flush on that queue, which waits for those reads
+  Vec<PendingCopy> deferred{};
+
+  if (transfer.is_some()) {
+    const auto reused = ranges::stable_partition(
+      pending,
+      [this](const PendingCopy& copy) {
+        return not uploaded.contains(copy.dst);
+      }
+    );
+
+    deferred.assign(reused.begin(), reused.end());
+    pending.erase(reused.begin(), reused.end());
+  }
+
+  if (pending.empty()) {
+    pending = std::move(deferred);
+    return {};
+  }
+
+  if (transfer.is_none()) {
+    // a previous frame may still be reading the destinations
+    const vk::MemoryBarrier2 before{
+      .srcStageMask = CONSUMER_STAGES,
+      .srcAccessMask = {},
+      .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    };
+
+    cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &before}
+    );
+  }
+
+  // one vkCmdCopyBuffer per destination, with every region for it
+  ranges::stable_sort(pending, {}, [](const PendingCopy& copy) {
+    return static_cast<VkBuffer>(copy.dst);
+  });
+
+  Vec<vk::BufferCopy> regions{};
+  regions.reserve(pending.size());
+
+  Vec<vk::BufferMemoryBarrier2> releases{};
+  Vec<vk::BufferMemoryBarrier2> acquires{};
+
+  for (usize i = 0; i < pending.size(); i++) {
+    regions.push_back(pending[i].region);
+
+    const bool last_for_dst =
+      i + 1 == pending.size() or pending[i + 1].dst != pending[i].dst;
+
+    if (not last_for_dst) {
+      continue;
+    }
+
+    cmd.copyBuffer(buffer.get(), pending[i].dst, regions);
+    regions.clear();
+    uploaded.insert(pending[i].dst);
+
+    if (transfer.is_none()) {
+      continue;
+    }
+
+    const auto [src_family, dst_family] = transfer.get_unchecked();
+
+    releases.push_back(queue_ownership::release(
+      pending[i].dst,
+      src_family,
+      dst_family,
+      vk::PipelineStageFlagBits2::eCopy,
+      vk::AccessFlagBits2::eTransferWrite
+    ));
+
+    acquires.push_back(queue_ownership::acquire(
+      pending[i].dst,
+      src_family,
+      dst_family,
+      CONSUMER_STAGES,
+      CONSUMER_ACCESS
+    ));
+  }
+
+  // the deferred copies' ring space is retired along with these, which is
+  // no earlier than the flush that records them
+  pending = std::move(deferred);
+  ring.submit(timeline_value);
+
+  if (transfer.is_some()) {
+    queue_ownership::record(cmd, releases);
+    return acquires;
+  }
+
+  const vk::MemoryBarrier2 after{
+    .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .dstStageMask = CONSUMER_STAGES,
+    .dstAccessMask = CONSUMER_ACCESS,
+  };
+
+  cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &after});
+  return {};
+}
+
+auto StagingRing::retire(const u64 completed_value) -> void {
+  ring.retire(completed_value);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <option.hpp>
+#include <unordered_set>
+#include "GpuAllocator.hpp"
+#include "RingAllocator.hpp"
+
+// Persistently mapped, host visible ring buffer that uploads go through.
+// Uploads are memcpy'd straight into the ring and the matching copies are
+// batched up, then recorded in one go by flush() each frame. Ring space is
+// recycled once the frame timeline passes the frame that consumed it, so
+// nothing is allocated per upload and nothing waits on the queue.
+class StagingRing {
+public:
+
+  static constexpr vk::DeviceSize DEFAULT_SIZE = 32ull << 20;
+
+  // dst stages / accesses that consume uploaded data, flush() makes the
+  // copies visible to these, compute reads instances for GPU culling
+  static constexpr vk::PipelineStageFlags2 CONSUMER_STAGES =
+    vk::PipelineStageFlagBits2::eVertexAttributeInput
+    | vk::PipelineStageFlagBits2::eIndexInput
+    | vk::PipelineStageFlagBits2::eComputeShader;
+  static constexpr vk::AccessFlags2 CONSUMER_ACCESS =
+    vk::AccessFlagBits2::eVertexAttributeRead
+    | vk::AccessFlagBits2::eIndexRead
+    | vk::AccessFlagBits2::eShaderStorageRead;
+
+  // flush() on one queue family for consumption on another
+  struct QueueTransfer {
+    u32 src_family;
+    u32 dst_family;
+  };
+
+  auto init(
+    GpuAllocator& allocator,
+    vk::DeviceSize size,
+    vk::DeviceSize alignment
+  ) -> void;
+
+  auto clear() -> void;
+
+  // copies data into the ring and queues a copy into dst, returns false if
+  // the ring is full until earlier frames retire
+  [[nodiscard]] auto upload(
+    Span<const u8> data,
+    vk::Buffer dst,
+    vk::DeviceSize dst_offset = 0
+  ) -> bool;
+
+  template<typename T>
+  [[nodiscard]] auto upload(
+    const Span<const T> data,
+    const vk::Buffer dst,
+    const vk::DeviceSize dst_offset = 0
+  ) -> bool {
+    return upload(as_bytes(data), dst, dst_offset);
+  }
+
+  // records every queued copy into cmd, the ring space they used is freed
+  // once timeline_value completes.
+  //
+  // With a transfer, cmd belongs to a queue of src_family (eg. a dedicated
+  // transfer queue) and every destination is released to dst_family. The
+  // returned acquire barriers must be recorded on dst_family's queue after a
+  // semaphore wait on this submission. Only destinations never uploaded to
+  // before go this way, nothing can be reading those yet. Copies into any
+  // other stay queued for a flush() without a transfer, on the queue that
+  // owns and reads them.
+  auto flush(
+    const vk::raii::CommandBuffer& cmd,
+    u64 timeline_value,
+    Option<QueueTransfer> transfer = {}
+  ) -> Vec<vk::BufferMemoryBarrier2>;
+
+  auto retire(u64 completed_value) -> void;
+
+  [[nodiscard]] auto has_pending() const -> bool {
+    return not pending.empty();
+  }
+
+  // whether a flush() with a transfer would record anything
+  [[nodiscard]] auto has_pending_first_uploads() const -> bool;
+
+  [[nodiscard]] auto get_buffer() const -> const GpuBuffer& { return buffer; }
+
+private:
+
+  struct PendingCopy {
+    vk::Buffer dst;
+    vk::BufferCopy region;
+  };
+
+  [[nodiscard]] static auto as_bytes(const auto data) -> Span<const u8> {
+    return {
+      reinterpret_cast<const u8*>(data.data()), // NOLINT
+      data.size_bytes(),
+    };
+  }
+
+  GpuBuffer buffer{};
+  RingAllocator ring{};
+  Vec<PendingCopy> pending{};
+
+  // every destination a flush() has copied into so far
+  std::unordered_set<VkBuffer> uploaded{};
+};
@@ -0,0 +1,225 @@
+#include "TaskGraph.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+auto TaskGraph::add(
+  const StringView name,
+  Task task,
+  const std::initializer_list<TaskId> dependencies,
+  const Affinity affinity
+) -> TaskId {
+  const auto id = static_cast<TaskId>(nodes.size());
+
+  for (const TaskId dependency: dependencies) {
+    if (dependency >= id) {
+      throw std::runtime_error{
+        fmt::format("Task '{}' depends on a task added after it", name)
+      };
+    }
+
+    nodes.at(dependency).dependents.push_back(id);
+  }
+
+  nodes.push_back({
+    .name = name,
+    .task = std::move(task),
+    .affinity = affinity,
+    .dependencies = dependencies,
+    .remaining = static_cast<u32>(dependencies.size()),
+  });
+
+  return id;
+}
+
+auto TaskGraph::run(JobSystem& jobs) -> void {
+  this->jobs = &jobs;
+
+  for (TaskId id = 0; id < nodes.size(); id++) {
+    if (nodes[id].remaining == 0) {
+      schedule(id);
+    }
+  }
+
+  {
+    std::unique_lock lock{mutex};
+
+    while (true) {
+      wake.wait(lock, [this] {
+        return not main_thread_ready.empty() or completed == nodes.size()
+            or error != nullptr;
+      });
+
+      if (error != nullptr or main_thread_ready.empty()) {
+        break;
+      }
+
+      const TaskId id{main_thread_ready.back()};
+      main_thread_ready.pop_back();
+
+      lock.unlock();
+      execute(id);
+      lock.lock();
+    }
+  }
+
+  // tasks that were already running when one failed still have to finish
+  jobs.wait(counter);
+
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+auto TaskGraph::schedule(const TaskId id) -> void {
+  if (nodes[id].affinity == Affinity::eMainThread) {
+    {
+      std::lock_guard lock{mutex};
+      main_thread_ready.push_back(id);
+    }
+    wake.notify_all();
+    return;
+  }
+
+  jobs->submit(counter, [this, id] { execute(id); });
+}
+
+auto TaskGraph::execute(const TaskId id) -> void {
+  Node& node{nodes[id]};
+
+  node.start = Clock::now();
+
+  try {
+    node.task();
+  } catch (...) {
+    {
+      std::lock_guard lock{mutex};
+
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+    }
+    wake.notify_all();
+
+    // dependents never run, run() stops waiting on them
+    return;
+  }
+
+  node.end = Clock::now();
+
+  Vec<TaskId> ready{};
+
+  {
+    std::lock_guard lock{mutex};
+    completed++;
+
+    for (const TaskId dependent: node.dependents) {
+      if (--nodes[dependent].remaining == 0) {
+        ready.push_back(dependent);
+      }
+    }
+  }
+
+  for (const TaskId dependent: ready) {
+    schedule(dependent);
+  }
+
+  wake.notify_all();
+}
+
+auto TaskGraph::duration_ms(const TaskId id) const -> f64 {
+  return std::chrono::duration<f64, std::milli>{nodes[id].end - nodes[id].start}
+    .count();
+}
+
+auto TaskGraph::get_timings() const -> Vec<Timing> {
+  Vec<Timing> timings{};
+  timings.reserve(nodes.size());
+
+  for (const Node& node: nodes) {
+    timings.push_back({
+      .name = node.name,
+      .start = node.start,
+      .end = node.end,
+    });
+  }
+
+  return timings;
+}
+
+auto TaskGraph::critical_path() const -> Vec<TaskId> {
+  if (nodes.empty()) {
+    return {};
+  }
+
+  // insertion order is topological, so one forward pass finds the longest
+  // chain ending at every task
+  Vec<f64> chain_ms(nodes.size(), 0.0);
+  Vec<Option<TaskId>> previous(nodes.size());
+
+  for (TaskId id = 0; id < nodes.size(); id++) {
+    for (const TaskId dependency: nodes[id].dependencies) {
+      if (chain_ms[dependency] > chain_ms[id]) {
+        chain_ms[id] = chain_ms[dependency];
+        previous[id] = dependency;
+      }
+    }
+
+    chain_ms[id] += duration_ms(id);
+  }
+
+  TaskId last{0};
+
+  for (TaskId id = 1; id < nodes.size(); id++) {
+    if (chain_ms[id] > chain_ms[last]) {
+      last = id;
+    }
+  }
+
+  Vec<TaskId> path{last};
+
+  while (previous[path.back()].is_some()) {
+    path.push_back(previous[path.back()].get_unchecked());
+  }
+
+  ranges::reverse(path);
+  return path;
+}
+
+auto TaskGraph::log_critical_path() const -> void {
+  const Vec<TaskId> path{critical_path()};
+
+  if (path.empty()) {
+    return;
+  }
+
+  Clock::time_point first{nodes.front().start};
+  Clock::time_point last{nodes.front().end};
+  f64 total_ms{0.0};
+
+  for (TaskId id = 0; id < nodes.size(); id++) {
+    first = std::min(first, nodes[id].start);
+    last = std::max(last, nodes[id].end);
+    total_ms += duration_ms(id);
+  }
+
+  f64 path_ms{0.0};
+  String chain{};
+
+  for (const TaskId id: path) {
+    path_ms += duration_ms(id);
+    chain += fmt::format(
+      "{}{} ({:.1f}ms)",
+      chain.empty() ? "" : " -> ",
+      nodes[id].name,
+      duration_ms(id)
+    );
+  }
+
+  spdlog::info(
+    "Startup took {:.1f}ms for {:.1f}ms of work, critical path {:.1f}ms: {}",
+    std::chrono::duration<f64, std::milli>{last - first}.count(),
+    total_ms,
+    path_ms,
+    chain
+  );
+}
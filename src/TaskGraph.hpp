@@ -0,0 +1,84 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include "JobSystem.hpp"
+
+// One-shot dependency graph of tasks run across the job system, each task
+// starting as soon as everything it depends on has finished. Tasks pinned to
+// the main thread (eg. anything GLFW) run on whichever thread calls run().
+//
+// Dependencies must be added before their dependents, so insertion order is
+// always a valid topological order.
+class TaskGraph {
+public:
+
+  using Clock = std::chrono::steady_clock;
+  using TaskId = u32;
+  using Task = std::function<void()>;
+
+  enum class Affinity {
+    eAnyThread,
+    eMainThread,
+  };
+
+  struct Timing {
+    StringView name;
+    Clock::time_point start;
+    Clock::time_point end;
+  };
+
+  auto add(
+    StringView name,
+    Task task,
+    std::initializer_list<TaskId> dependencies = {},
+    Affinity affinity = Affinity::eAnyThread
+  ) -> TaskId;
+
+  // blocks until every task ran, rethrows the first exception a task threw
+  // once the ones already running have finished
+  auto run(JobSystem& jobs) -> void;
+
+  // in insertion order, only valid after run()
+  [[nodiscard]] auto get_timings() const -> Vec<Timing>;
+
+  // longest chain of dependent tasks by measured duration, first to last
+  [[nodiscard]] auto critical_path() const -> Vec<TaskId>;
+
+  auto log_critical_path() const -> void;
+
+private:
+
+  struct Node {
+    StringView name;
+    Task task;
+    Affinity affinity;
+    Vec<TaskId> dependencies{};
+    Vec<TaskId> dependents{};
+    u32 remaining{0};
+    Clock::time_point start{};
+    Clock::time_point end{};
+  };
+
+  auto schedule(TaskId id) -> void;
+
+  auto execute(TaskId id) -> void;
+
+  [[nodiscard]] auto duration_ms(TaskId id) const -> f64;
+
+  Vec<Node> nodes{};
+
+  JobSystem* jobs{nullptr};
+  JobSystem::Counter counter{};
+
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  Vec<TaskId> main_thread_ready{};
+  usize completed{0};
+  std::exception_ptr error{};
+};
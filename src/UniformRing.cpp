@@ -0,0 +1,154 @@
+#include "UniformRing.hpp"
+#include <cstring>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+auto UniformRing::init(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physical_device,
+  GpuAllocator& allocator,
+  const vk::DeviceSize size
+) -> void {
+  const vk::DeviceSize alignment{
+    physical_device.getProperties().limits.minUniformBufferOffsetAlignment
+  };
+
+  // the descriptor always covers MAX_PUSH_SIZE past its offset, even for a
+  // smaller push at the very end of the ring
+  buffer = allocator.create_buffer(
+    {
+      .size = size + MAX_PUSH_SIZE,
+      .usage = vk::BufferUsageFlagBits::eUniformBuffer,
+      .sharingMode = vk::SharingMode::eExclusive,
+    },
+    vk::MemoryPropertyFlagBits::eHostVisible
+  );
+
+  ring = RingAllocator{size, alignment};
+
+  const vk::DescriptorSetLayoutBinding binding{
+    .binding = BINDING,
+    .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+    .descriptorCount = 1,
+    .stageFlags = vk::ShaderStageFlagBits::eAll,
+  };
+
+  set_layout = vk::raii::DescriptorSetLayout{
+    device,
+    vk::DescriptorSetLayoutCreateInfo{
+      .bindingCount = 1,
+      .pBindings = &binding,
+    },
+  };
+
+  const vk::DescriptorPoolSize pool_size{
+    .type = vk::DescriptorType::eUniformBufferDynamic,
+    .descriptorCount = 1,
+  };
+
+  // the raii set frees itself, which the pool has to allow
+  descriptor_pool = vk::raii::DescriptorPool{
+    device,
+    vk::DescriptorPoolCreateInfo{
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = 1,
+      .poolSizeCount = 1,
+      .pPoolSizes = &pool_size,
+    },
+  };
+
+  vk::raii::DescriptorSets sets{
+    device,
+    vk::DescriptorSetAllocateInfo{
+      .descriptorPool = descriptor_pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &*set_layout,
+    },
+  };
+  descriptor_set = std::move(sets.front());
+
+  // written once, every push only changes the dynamic offset it is bound at
+  const vk::DescriptorBufferInfo buffer_info{
+    .buffer = buffer.get(),
+    .offset = 0,
+    .range = MAX_PUSH_SIZE,
+  };
+
+  device.updateDescriptorSets(
+    vk::WriteDescriptorSet{
+      .dstSet = descriptor_set,
+      .dstBinding = BINDING,
+      .dstArrayElement = 0,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+      .pBufferInfo = &buffer_info,
+    },
+    {}
+  );
+
+  spdlog::info(
+    "Uniform ring: {} KiB, {} byte alignment",
+    size >> 10,
+    alignment
+  );
+}
+
+auto UniformRing::clear() -> void {
+  descriptor_set.clear();
+  descriptor_pool.clear();
+  set_layout.clear();
+  buffer.reset();
+}
+
+auto UniformRing::push(const Span<const u8> data) -> u32 {
+  if (data.size() > MAX_PUSH_SIZE) {
+    throw std::runtime_error{fmt::format(
+      "Uniform ring push of {} bytes is over the {} byte limit",
+      data.size(),
+      MAX_PUSH_SIZE
+    )};
+  }
+
+  Option<u64> offset{};
+
+  {
+    std::lock_guard lock{mutex};
+    offset = ring.allocate(data.size());
+  }
+
+  if (offset.is_none()) {
+    throw std::runtime_error{fmt::format(
+      "Uniform ring is full ({} KiB), frames in flight pushed more than it "
+      "holds",
+      ring.get_size() >> 10
+    )};
+  }
+
+  // the range is only ours, so the copy happens outside the lock
+  std::memcpy(
+    buffer.mapped() + offset.get_unchecked(),
+    data.data(),
+    data.size()
+  );
+
+  return static_cast<u32>(offset.get_unchecked());
+}
+
+auto UniformRing::submit(const u64 timeline_value) -> void {
+  std::lock_guard lock{mutex};
+  ring.submit(timeline_value);
+}
+
+auto UniformRing::retire(const u64 completed_value) -> void {
+  std::lock_guard lock{mutex};
+  ring.retire(completed_value);
+}
+
+auto UniformRing::bind(
+  const vk::raii::CommandBuffer& cmd,
+  const vk::PipelineBindPoint point,
+  const vk::PipelineLayout layout,
+  const u32 offset
+) const -> void {
+  cmd.bindDescriptorSets(point, layout, SET, {*descriptor_set}, {offset});
+}
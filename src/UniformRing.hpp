@@ -0,0 +1,83 @@
+#pragma once
+
+#include <preamble.hpp>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <mutex>
+#include <type_traits>
+#include "GpuAllocator.hpp"
+#include "RingAllocator.hpp"
+
+// Persistently mapped, host visible uniform buffer that per draw constants
+// are written into. push() copies into the ring and returns the dynamic
+// offset to bind the ring's one descriptor set at, so no descriptor is ever
+// written per frame. Ring space is recycled once the frame timeline passes
+// the frame that read it, like StagingRing.
+//
+// push() is thread safe, so recording threads can push their own draws'.
+class UniformRing {
+public:
+
+  // shaders read the ring through [[vk::binding(BINDING, SET)]], set 0 is
+  // the bindless heap's
+  static constexpr u32 SET = 1;
+  static constexpr u32 BINDING = 0;
+
+  // the descriptor's range, so the most a single push() may write
+  static constexpr vk::DeviceSize MAX_PUSH_SIZE = 256;
+
+  static constexpr vk::DeviceSize DEFAULT_SIZE = 4ull << 20;
+
+  auto init(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    GpuAllocator& allocator,
+    vk::DeviceSize size = DEFAULT_SIZE
+  ) -> void;
+
+  auto clear() -> void;
+
+  // copies data into the ring and returns its dynamic offset, throws if the
+  // frames in flight have used the whole ring
+  [[nodiscard]] auto push(Span<const u8> data) -> u32;
+
+  template<typename T>
+  [[nodiscard]] auto push(const T& constants) -> u32 {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(sizeof(T) <= MAX_PUSH_SIZE);
+
+    return push(Span<const u8>{
+      reinterpret_cast<const u8*>(&constants), // NOLINT
+      sizeof(T),
+    });
+  }
+
+  // tags everything pushed since the last submit with timeline_value
+  auto submit(u64 timeline_value) -> void;
+
+  auto retire(u64 completed_value) -> void;
+
+  // binds the ring at SET of layout, reading from offset
+  auto bind(
+    const vk::raii::CommandBuffer& cmd,
+    vk::PipelineBindPoint point,
+    vk::PipelineLayout layout,
+    u32 offset
+  ) const -> void;
+
+  [[nodiscard]] auto get_set_layout() const -> vk::DescriptorSetLayout {
+    return set_layout;
+  }
+
+private:
+
+  GpuBuffer buffer{};
+
+  // guards ring, recording threads push concurrently
+  std::mutex mutex{};
+  RingAllocator ring{};
+
+  vk::raii::DescriptorSetLayout set_layout{nullptr};
+  vk::raii::DescriptorPool descriptor_pool{nullptr};
+  vk::raii::DescriptorSet descriptor_set{nullptr};
+};
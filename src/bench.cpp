@@ -0,0 +1,437 @@
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include "App.hpp"
+#include "CommandLine.hpp"
+
+// Headless benchmark runner. Every scene boots a fresh App against a software
+// ICD from a cold pipeline cache, renders a fixed number of frames and the
+// results are written as JSON, optionally compared against a baseline run.
+
+struct Scene {
+  StringView name;
+  u32 object_count;
+  bool gpu_driven;
+  f32 render_scale{1.0f};
+};
+
+static constexpr std::array SCENES{
+  Scene{.name = "triangle", .object_count = 1, .gpu_driven = false},
+  Scene{.name = "objects-10k", .object_count = 10'000, .gpu_driven = false},
+  Scene{.name = "gpu-driven-100k", .object_count = 100'000, .gpu_driven = true},
+  Scene{
+    .name = "triangle-half-res",
+    .object_count = 1,
+    .gpu_driven = false,
+    .render_scale = 0.5f,
+  },
+};
+
+struct BenchConfig {
+  // software rasterizer, so numbers do not depend on the machine's GPU
+  String device{"llvmpipe"};
+
+  u64 frames{500};
+
+  // rendered before measuring, these fall out of the percentile window
+  u64 warmup_frames{50};
+
+  // empty runs every scene
+  Vec<String> scenes{};
+
+  std::filesystem::path output{"bench.json"};
+  std::filesystem::path baseline{};
+
+  // relative slowdown of a metric that counts as a regression
+  f64 threshold{0.10};
+};
+
+struct SceneResult {
+  StringView name;
+  u64 frames;
+  Profiler::Percentiles cpu_frame;
+  Option<Profiler::Percentiles> gpu_frame;
+  Option<Profiler::Percentiles> sample_to_submit;
+  Vec<InitStageTiming> init_stages;
+  f64 init_total_ms;
+};
+
+static constexpr StringView BENCH_PIPELINE_CACHE{"bench_pipeline_cache.bin"};
+
+// differences below this are noise no matter the relative change
+static constexpr f64 MIN_REGRESSION_MS = 0.05;
+
+[[nodiscard]] static auto parse_args(const Span<char*> args) -> BenchConfig {
+  BenchConfig config{};
+
+  for (usize i = 1; i < args.size(); i++) {
+    const StringView arg{args[i]};
+
+    if (arg == "--device" and i + 1 < args.size()) {
+      config.device = args[++i];
+    } else if (arg == "--frames" and i + 1 < args.size()) {
+      config.frames = command_line::parse_number<u64>(arg, args[++i]);
+    } else if (arg == "--warmup" and i + 1 < args.size()) {
+      config.warmup_frames =
+        command_line::parse_number<u64>(arg, args[++i]);
+    } else if (arg == "--scene" and i + 1 < args.size()) {
+      config.scenes.emplace_back(args[++i]);
+    } else if (arg == "--output" and i + 1 < args.size()) {
+      config.output = args[++i];
+    } else if (arg == "--baseline" and i + 1 < args.size()) {
+      config.baseline = args[++i];
+    } else if (arg == "--threshold" and i + 1 < args.size()) {
+      config.threshold = command_line::parse_number<f64>(arg, args[++i]);
+    } else {
+      spdlog::warn("Unknown argument '{}'", arg);
+    }
+  }
+
+  return config;
+}
+
+[[nodiscard]] static auto run_scene(
+  const BenchConfig& bench,
+  const Scene& scene,
+  String& device_name
+) -> SceneResult {
+  spdlog::info("Running scene '{}'", scene.name);
+
+  // startup numbers are only comparable from a cold pipeline cache
+  const std::filesystem::path cache_path{BENCH_PIPELINE_CACHE};
+  std::filesystem::remove(cache_path);
+
+  App app{AppConfig{
+    .headless = true,
+    .preferred_device = bench.device,
+    .require_preferred_device = true,
+    .frame_limit = bench.warmup_frames + bench.frames,
+    .pipeline_cache_path = cache_path,
+    .object_count = scene.object_count,
+    .gpu_driven = scene.gpu_driven,
+    .render_scale = scene.render_scale,
+    .profiler_history = bench.frames,
+  }};
+
+  app.run();
+
+  const Profiler& profiler{app.get_profiler()};
+  const Option<Profiler::Percentiles> cpu_frame{
+    profiler.get_cpu_percentiles("frame")
+  };
+
+  if (cpu_frame.is_none()) {
+    throw std::runtime_error{
+      fmt::format("Scene '{}' did not render any frames", scene.name)
+    };
+  }
+
+  const Span<const InitStageTiming> stages{app.get_init_stages()};
+  device_name = app.get_device_name();
+
+  // stages overlap, so the total is the wall time rather than their sum
+  const Option<Profiler::Percentiles> init{
+    profiler.get_cpu_percentiles("init_vulkan")
+  };
+
+  return {
+    .name = scene.name,
+    .frames = std::min(app.get_frame_count(), bench.frames),
+    .cpu_frame = cpu_frame.get_unchecked(),
+    .gpu_frame = profiler.get_gpu_percentiles("frame"),
+    .sample_to_submit = profiler.get_cpu_percentiles("sample_to_submit"),
+    .init_stages = {stages.begin(), stages.end()},
+    .init_total_ms = init.is_some() ? init.get_unchecked().max_ms : 0.0,
+  };
+}
+
+// the metrics a baseline comparison looks at, lower is better for all of them
+[[nodiscard]] static auto get_metrics(const Span<const SceneResult> results)
+  -> std::map<String, f64> {
+  std::map<String, f64> metrics{};
+
+  for (const SceneResult& result: results) {
+    const auto add = [&](const StringView group, const auto& stats) {
+      metrics[fmt::format("{}/{}/p50", result.name, group)] = stats.p50_ms;
+      metrics[fmt::format("{}/{}/p95", result.name, group)] = stats.p95_ms;
+      metrics[fmt::format("{}/{}/p99", result.name, group)] = stats.p99_ms;
+    };
+
+    add("cpu_frame_ms", result.cpu_frame);
+
+    if (result.gpu_frame.is_some()) {
+      add("gpu_frame_ms", result.gpu_frame.get_unchecked());
+    }
+
+    if (result.sample_to_submit.is_some()) {
+      add("sample_to_submit_ms", result.sample_to_submit.get_unchecked());
+    }
+
+    metrics[fmt::format("{}/init_total_ms", result.name)] =
+      result.init_total_ms;
+  }
+
+  return metrics;
+}
+
+[[nodiscard]] static auto format_percentiles(const Profiler::Percentiles& stats)
+  -> String {
+  return fmt::format(
+    "{{\"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}}}",
+    stats.p50_ms,
+    stats.p95_ms,
+    stats.p99_ms,
+    stats.max_ms
+  );
+}
+
+static auto write_report(
+  const BenchConfig& bench,
+  const StringView device_name,
+  const Span<const SceneResult> results
+) -> void {
+  std::ofstream file{bench.output, std::ios::trunc};
+
+  if (not file.is_open()) {
+    throw std::runtime_error{
+      fmt::format("Failed to open '{}' for writing", bench.output.string())
+    };
+  }
+
+  file << fmt::format(
+    "{{\n  \"version\": 1,\n  \"device\": \"{}\",\n  \"frames\": {},\n"
+    "  \"warmup_frames\": {},\n  \"scenes\": [",
+    device_name,
+    bench.frames,
+    bench.warmup_frames
+  );
+
+  for (usize i = 0; i < results.size(); i++) {
+    const SceneResult& result{results[i]};
+
+    file << fmt::format(
+      "{}\n    {{\n      \"name\": \"{}\",\n      \"frames\": {},\n"
+      "      \"cpu_frame_ms\": {},\n      \"gpu_frame_ms\": {},\n"
+      "      \"sample_to_submit_ms\": {},\n"
+      "      \"init_total_ms\": {:.4f},\n      \"init_ms\": {{",
+      i == 0 ? "" : ",",
+      result.name,
+      result.frames,
+      format_percentiles(result.cpu_frame),
+      result.gpu_frame.is_some()
+        ? format_percentiles(result.gpu_frame.get_unchecked())
+        : "null",
+      result.sample_to_submit.is_some()
+        ? format_percentiles(result.sample_to_submit.get_unchecked())
+        : "null",
+      result.init_total_ms
+    );
+
+    for (usize j = 0; j < result.init_stages.size(); j++) {
+      file << fmt::format(
+        "{}\n        \"{}\": {:.4f}",
+        j == 0 ? "" : ",",
+        result.init_stages[j].name,
+        result.init_stages[j].ms
+      );
+    }
+
+    file << "\n      }\n    }";
+  }
+
+  // flat and one per line, this is what --baseline reads back
+  file << "\n  ],\n  \"metrics\": {";
+
+  const std::map<String, f64> metrics{get_metrics(results)};
+  bool first{true};
+
+  for (const auto& [name, value]: metrics) {
+    file << fmt::format(
+      "{}\n    \"{}\": {:.4f}",
+      first ? "" : ",",
+      name,
+      value
+    );
+    first = false;
+  }
+
+  file << "\n  }\n}\n";
+
+  spdlog::info("Wrote benchmark report to '{}'", bench.output.string());
+}
+
+struct Baseline {
+  String device_name;
+  std::map<String, f64> metrics;
+};
+
+// reads the device and the "metrics" object of a report written by
+// write_report, this is not a general JSON parser
+[[nodiscard]] static auto read_baseline(const std::filesystem::path& path)
+  -> Baseline {
+  std::ifstream file{path};
+
+  if (not file.is_open()) {
+    throw std::runtime_error{
+      fmt::format("Failed to open baseline '{}'", path.string())
+    };
+  }
+
+  Baseline baseline{};
+  String line{};
+  bool in_metrics{false};
+
+  while (std::getline(file, line)) {
+    if (not in_metrics) {
+      constexpr StringView DEVICE_KEY{"\"device\": \""};
+      const usize device{line.find(DEVICE_KEY)};
+
+      if (device != String::npos) {
+        const usize begin{device + DEVICE_KEY.size()};
+        baseline.device_name = line.substr(begin, line.rfind('"') - begin);
+      }
+
+      in_metrics = line.find("\"metrics\"") != String::npos;
+      continue;
+    }
+
+    const usize name_begin{line.find('"')};
+    const usize name_end{line.find('"', name_begin + 1)};
+    const usize colon{line.find(':', name_end)};
+
+    if (name_begin == String::npos or name_end == String::npos
+        or colon == String::npos) {
+      break;
+    }
+
+    baseline.metrics[line.substr(name_begin + 1, name_end - name_begin - 1)] =
+      std::stod(line.substr(colon + 1));
+  }
+
+  return baseline;
+}
+
+// returns the number of regressed metrics
+[[nodiscard]] static auto compare(
+  const BenchConfig& bench,
+  const StringView device_name,
+  const Span<const SceneResult> results
+) -> u32 {
+  const auto [baseline_device, baseline] = read_baseline(bench.baseline);
+  const std::map<String, f64> current{get_metrics(results)};
+
+  // numbers from other hardware say nothing about this change
+  if (baseline_device != device_name) {
+    throw std::runtime_error{fmt::format(
+      "Baseline '{}' was recorded on '{}', not '{}'",
+      bench.baseline.string(),
+      baseline_device,
+      device_name
+    )};
+  }
+
+  u32 regressions{0};
+
+  for (const auto& [name, value]: current) {
+    const auto found = baseline.find(name);
+
+    if (found == baseline.end()) {
+      spdlog::info("{:<40} {:10.4f}ms  (not in baseline)", name, value);
+      continue;
+    }
+
+    const f64 previous{found->second};
+    const f64 change = previous > 0.0 ? value / previous - 1.0 : 0.0;
+
+    const bool regressed{
+      change > bench.threshold and value - previous > MIN_REGRESSION_MS
+    };
+
+    if (regressed) {
+      regressions++;
+      spdlog::error(
+        "{:<40} {:10.4f}ms -> {:10.4f}ms  ({:+.1f}%) REGRESSION",
+        name,
+        previous,
+        value,
+        change * 100.0
+      );
+    } else {
+      spdlog::info(
+        "{:<40} {:10.4f}ms -> {:10.4f}ms  ({:+.1f}%)",
+        name,
+        previous,
+        value,
+        change * 100.0
+      );
+    }
+  }
+
+  return regressions;
+}
+
+i32 main(i32 argc, char** argv) {
+  BenchConfig bench{};
+
+  try {
+    bench = parse_args({argv, static_cast<usize>(argc)});
+  } catch (const std::exception& e) {
+    spdlog::error("Runtime Exception: {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  if (App::ENABLE_VALIDATION_LAYERS) {
+    spdlog::warn("Benchmarking with validation layers, build with NDEBUG");
+  }
+
+  Vec<SceneResult> results{};
+  String device_name{};
+
+  try {
+    for (const Scene& scene: SCENES) {
+      const bool selected{
+        bench.scenes.empty()
+        or ranges::find(bench.scenes, scene.name) != bench.scenes.end()
+      };
+
+      if (selected) {
+        results.push_back(run_scene(bench, scene, device_name));
+      }
+    }
+
+    if (results.empty()) {
+      spdlog::error("No scenes matched");
+      return EXIT_FAILURE;
+    }
+
+    write_report(bench, device_name, results);
+  } catch (const std::exception& e) {
+    spdlog::error("Runtime Exception: {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  if (bench.baseline.empty()) {
+    return 0;
+  }
+
+  try {
+    const u32 regressions{compare(bench, device_name, results)};
+
+    if (regressions != 0) {
+      spdlog::error(
+        "{} metric(s) regressed more than {:.0f}% against '{}'",
+        regressions,
+        bench.threshold * 100.0,
+        bench.baseline.string()
+      );
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception& e) {
+    spdlog::error("Runtime Exception: {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  spdlog::info("No regressions against '{}'", bench.baseline.string());
+  return 0;
+}
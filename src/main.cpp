@@ -1,11 +1,76 @@
 #include <spdlog/spdlog.h>
 #include "App.hpp"
+#include "CommandLine.hpp"
 
-i32 main() {
-  App app;
-  app.run();
+[[nodiscard]] static auto parse_args(const Span<char*> args) -> AppConfig {
+  AppConfig config{};
 
+  for (usize i = 1; i < args.size(); i++) {
+    const StringView arg{args[i]};
+
+    if (arg == "--headless") {
+      config.headless = true;
+    } else if (arg == "--device" and i + 1 < args.size()) {
+      config.preferred_device = args[++i];
+    } else if (arg == "--latency" and i + 1 < args.size()) {
+      const StringView name{args[++i]};
+      const Option<LatencyProfile> profile{latency_profile::parse(name)};
+
+      if (profile.is_some()) {
+        config.latency_profile = profile.get_unchecked();
+      } else {
+        spdlog::warn("Unknown latency profile '{}'", name);
+      }
+    } else if (arg == "--frames-in-flight" and i + 1 < args.size()) {
+      config.frames_in_flight = command_line::parse_number<u32>(arg, args[++i]);
+    } else if (arg == "--frames" and i + 1 < args.size()) {
+      config.frame_limit = command_line::parse_number<u64>(arg, args[++i]);
+    } else if (arg == "--pipeline-cache" and i + 1 < args.size()) {
+      config.pipeline_cache_path = args[++i];
+    } else if (arg == "--hot-reload") {
+      config.hot_reload = true;
+    } else if (arg == "--objects" and i + 1 < args.size()) {
+      config.object_count = command_line::parse_number<u32>(arg, args[++i]);
+    } else if (arg == "--worker-threads" and i + 1 < args.size()) {
+      config.worker_threads = command_line::parse_number<u32>(arg, args[++i]);
+    } else if (arg == "--gpu-driven") {
+      config.gpu_driven = true;
+    } else if (arg == "--color-mode" and i + 1 < args.size()) {
+      config.color_mode = command_line::parse_number<u32>(arg, args[++i])
+                        % PipelineVariants::COLOR_MODE_COUNT;
+    } else if (arg == "--capture" and i + 1 < args.size()) {
+      config.capture_path = args[++i];
+    } else if (arg == "--capture-format" and i + 1 < args.size()) {
+      const StringView name{args[++i]};
+      const Option<CaptureFormat> format{capture_format::parse(name)};
+
+      if (format.is_some()) {
+        config.capture_format = format.get_unchecked();
+      } else {
+        spdlog::warn("Unknown capture format '{}'", name);
+      }
+    } else if (arg == "--shader-objects") {
+      config.shader_objects = true;
+    } else if (arg == "--particles" and i + 1 < args.size()) {
+      config.particle_count = command_line::parse_number<u32>(arg, args[++i]);
+    } else if (arg == "--windows" and i + 1 < args.size()) {
+      config.window_count =
+        std::max(command_line::parse_number<u32>(arg, args[++i]), 1u);
+    } else if (arg == "--render-scale" and i + 1 < args.size()) {
+      config.render_scale = command_line::parse_number<f32>(arg, args[++i]);
+    } else if (arg == "--trace" and i + 1 < args.size()) {
+      config.trace_path = args[++i];
+    } else {
+      spdlog::warn("Unknown argument '{}'", arg);
+    }
+  }
+
+  return config;
+}
+
+i32 main(i32 argc, char** argv) {
   try {
+    App app{parse_args({argv, static_cast<usize>(argc)})};
     app.run();
   } catch (const std::exception& e) {
     spdlog::error("Runtime Exception: {}", e.what());